@@ -31,6 +31,7 @@
 #include "DGtal/base/Common.h"
 
 #include <fstream>
+#include "opencv2/core/utility.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 
@@ -38,6 +39,12 @@
 
 
 #include <iostream>
+#include <filesystem>
+#include <map>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace cv;
 using namespace std;
@@ -66,9 +73,14 @@ using namespace DGtal;
    -r,--rho FLOAT=1                      The resolution of the parameter r in pixels. We use 1 pixel.
    -t,--theta FLOAT=0.0174533            The resolution of the parameter   heta in radians.
    -T,--threshold FLOAT=100              The minimum number of intersections to “detect” a line.
-   -m,--minLinLength UINT=10              The minimum number of points that can form a line. Lines with less than this number of points are disregarded (use only with --useProbabilist option).
-   -g,--maxLineGap FLOAT=3               The maximum gap between two points to be considered in the same line (use only with --useProbabilist option)
-   -P,--useProbabilist                   use improved probabilist algorithm
+   -m,--minLinLength UINT=10              The minimum number of points that can form a line. Lines with less than this number of points are disregarded (only with the probabilist algorithm).
+   -g,--maxLineGap FLOAT=3               The maximum gap between two points to be considered in the same line (only with the probabilist algorithm).
+   -P,--useProbabilist                   use improved probabilist algorithm (default).
+   -S,--useStandard                      use the standard Hough transform instead of the probabilist one (the lines are exported as long segments).
+   --no-display                          do not display the resulting lines (headless use).
+   -b,--batch TEXT:FILE                  process all the images listed in the given file (one image path per line) without display.
+   --outputDir TEXT                      output directory of the segment files in batch mode (by default the segments of image.png are written in image.png.lines); the images must have distinct file names.
+   --threads UINT=0                      number of threads used in batch mode (0: default number of threads).
    
  @endcode
 
@@ -76,6 +88,7 @@ using namespace DGtal;
 
  @code
    houghLineDetect -i  $DGtal/examples/samples/church.pgm -T 100 -P
+   houghLineDetect --batch imageList.txt --outputDir segments --threads 8 -T 100 -P
  @endcode
 
 
@@ -85,6 +98,144 @@ using namespace DGtal;
  */
 
 
+/**
+ * Parameters of the line detection (Canny followed by the Hough transform).
+ */
+struct HoughParameters
+{
+  double rho;
+  double theta;
+  double threshold;
+  unsigned int minLength;
+  double maxLineGap;
+  bool useProbabilist;
+};
+
+
+/**
+ * Detects the line segments of an image. The edge image buffer is
+ * given as parameter to be reused from an image to another.
+ *
+ * @param src the source image (gray level).
+ * @param edges the buffer used to store the result of the Canny filter.
+ * @param params the detection parameters.
+ * @return the line segments (x1 y1 x2 y2).
+ */
+static
+vector<Vec4i>
+detectLines(const Mat &src, Mat &edges, const HoughParameters &params)
+{
+  vector<Vec4i> segments;
+  Canny(src, edges, 50, 200, 3);
+  if(params.useProbabilist){
+    HoughLinesP(edges, segments, params.rho, params.theta, params.threshold,
+                params.minLength, params.maxLineGap );
+  }
+  else
+    {
+      vector<Vec2f> lines;
+      HoughLines(edges, lines, params.rho, params.theta, params.threshold, 0, 0 );
+      for( size_t i = 0; i < lines.size(); i++ )
+        {
+          float rho = lines[i][0], theta = lines[i][1];
+          double a = cos(theta), b = sin(theta);
+          double x0 = a*rho, y0 = b*rho;
+          segments.push_back(Vec4i(cvRound(x0 + 1000*(-b)), cvRound(y0 + 1000*(a)),
+                                   cvRound(x0 - 1000*(-b)), cvRound(y0 - 1000*(a))));
+        }
+    }
+  return segments;
+}
+
+
+static
+void
+exportSegments(const vector<Vec4i> &segments, const std::string &outputFileName)
+{
+  ofstream outStream;
+  outStream.open(outputFileName.c_str(), ofstream::binary);
+  for( size_t i = 0; i < segments.size(); i++ )
+    {
+      const Vec4i &l = segments[i];
+      outStream << l[0] << " " << l[1] << " " << l[2] << " " << l[3] << std::endl;
+    }
+  outStream.close();
+}
+
+
+/**
+ * Processes all the images of the list file on a pool of threads (each
+ * thread reuses its own image buffers) and exports the segments of each
+ * image in a separate file.
+ *
+ * @return the number of images which could not be read (or of output
+ * file names shared by several images, in which case nothing is done).
+ */
+static
+unsigned int
+processBatch(const std::string &listFileName, const std::string &outputDir,
+             const HoughParameters &params)
+{
+  std::vector<std::string> imageNames;
+  ifstream listStream (listFileName.c_str());
+  std::string line;
+  while (std::getline(listStream, line)){
+    if (line.size() != 0 && line[0] != '#'){
+      imageNames.push_back(line);
+    }
+  }
+  // with an output directory, images with the same file name in different
+  // directories would be written in the same file.
+  std::vector<std::string> outNames;
+  std::map<std::string, std::string> imageOfOutName;
+  unsigned int nbConflicts = 0;
+  for (const auto &name: imageNames){
+    std::string outName = name + ".lines";
+    if (outputDir != ""){
+      outName = outputDir + "/" + std::filesystem::path(name).filename().string() + ".lines";
+    }
+    auto it = imageOfOutName.find(outName);
+    if (it != imageOfOutName.end()){
+      trace.error() << "the segments of " << it->second << " and " << name
+                    << " would be written in the same file " << outName << std::endl;
+      nbConflicts++;
+    }
+    imageOfOutName[outName] = name;
+    outNames.push_back(outName);
+  }
+  if (nbConflicts != 0){
+    return nbConflicts;
+  }
+  if (outputDir != ""){
+    std::filesystem::create_directories(outputDir);
+  }
+  // the parallelism is done on the images.
+  cv::setNumThreads(1);
+  trace.info() << "Processing " << imageNames.size() << " images..." << std::endl;
+  unsigned int nbErrors = 0;
+  const long long nbImages = static_cast<long long>(imageNames.size());
+#pragma omp parallel reduction(+:nbErrors)
+  {
+    Mat src, edges;
+#pragma omp for schedule(dynamic)
+    for (long long i = 0; i < nbImages; i++){
+      const std::string &name = imageNames[i];
+      src = imread(name, IMREAD_GRAYSCALE);
+      if(src.empty())
+        {
+#pragma omp critical
+          trace.warning() << "can not open " << name << endl;
+          nbErrors++;
+          continue;
+        }
+      vector<Vec4i> segments = detectLines(src, edges, params);
+      exportSegments(segments, outNames[i]);
+    }
+  }
+  return nbErrors;
+}
+
+
 int main( int argc, char** argv )
 {
   // parse command line -------------------------------------------------------
@@ -92,32 +243,59 @@ int main( int argc, char** argv )
   CLI::App app;
   std::string inputFileName;
   std::string outputFileName;
-  double rho {1.0};
-  double theta {CV_PI/180.0};
-  double threshold {100.0};
-  unsigned int minLength {10};
-  double maxLineGap {3.0};
-  bool useProbabilist {false};
+  std::string batchFileName;
+  std::string outputDir;
+  HoughParameters params {1.0, CV_PI/180.0, 100.0, 10, 3.0, true};
+  bool useStandard {false};
+  bool noDisplay {false};
+  unsigned int nbThreads {0};
   
   
   app.description("Apply the Hough transform from the OpenCV implementation (see http://docs.opencv.org/2.4/doc/tutorials/imgproc/imgtrans/hough_lines/hough_lines.html).\nTypical use example:\n \t houghLineDetect -i  $DGtal/examples/samples/church.pgm -T 100 -P \n");
   
-  app.add_option("-i,--input,1", inputFileName, "the input image file." )
-  ->required()
+  auto inputOpt = app.add_option("-i,--input,1", inputFileName, "the input image file." )
   ->check(CLI::ExistingFile);
   app.add_option("--output,-o", outputFileName,  "the output file containing the resulting lines segments (one segment per lines).");
-  app.add_option("--rho,-r", rho,  "The resolution of the parameter r in pixels. We use 1 pixel." );
-  app.add_option("--theta,-t", theta,"The resolution of the parameter \theta in radians." );
-  app.add_option("--threshold,-T", threshold, "The minimum number of intersections to “detect” a line.");
-  app.add_option("--minLinLength,-m", minLength," The minimum number of points that can form a line. Lines with less than this number of points are disregarded (use only with --useProbabilist option).");
-  app.add_option("--maxLineGap,-g",maxLineGap, "The maximum gap between two points to be considered in the same line (use only with --useProbabilist option)" );
-  app.add_flag("--useProbabilist,-P", "use improved probabilist algorithm");
+  app.add_option("--rho,-r", params.rho,  "The resolution of the parameter r in pixels. We use 1 pixel." );
+  app.add_option("--theta,-t", params.theta,"The resolution of the parameter \theta in radians." );
+  app.add_option("--threshold,-T", params.threshold, "The minimum number of intersections to “detect” a line.");
+  app.add_option("--minLinLength,-m", params.minLength," The minimum number of points that can form a line. Lines with less than this number of points are disregarded (only with the probabilist algorithm).");
+  app.add_option("--maxLineGap,-g",params.maxLineGap, "The maximum gap between two points to be considered in the same line (only with the probabilist algorithm)." );
+  auto probabilistOpt = app.add_flag("--useProbabilist,-P", "use improved probabilist algorithm (default).");
+  app.add_flag("--useStandard,-S", useStandard, "use the standard Hough transform instead of the probabilist one (the lines are exported as long segments).")
+  ->excludes(probabilistOpt);
+  app.add_flag("--no-display", noDisplay, "do not display the resulting lines (headless use).");
+  auto batchOpt = app.add_option("--batch,-b", batchFileName, "process all the images listed in the given file (one image path per line) without display.")
+  ->check(CLI::ExistingFile)
+  ->excludes(inputOpt);
+  app.add_option("--outputDir", outputDir, "output directory of the segment files in batch mode (by default the segments of image.png are written in image.png.lines); the images must have distinct file names.");
+  app.add_option("--threads", nbThreads, "number of threads used in batch mode (0: default number of threads).");
   
   
   app.get_formatter()->column_width(40);
   CLI11_PARSE(app, argc, argv);
   // END parse command line using CLI ----------------------------------------------
 
+  if (inputOpt->count() == 0 && batchOpt->count() == 0)
+    {
+      trace.error() << "an input image (--input) or an image list (--batch) is required." << std::endl;
+      return -1;
+    }
+
+  params.useProbabilist = !useStandard;
+
+#ifdef _OPENMP
+  if (nbThreads != 0)
+    {
+      omp_set_num_threads(nbThreads);
+    }
+#endif
+
+  if (batchOpt->count() != 0)
+    {
+      unsigned int nbErrors = processBatch(batchFileName, outputDir, params);
+      return nbErrors == 0 ? 0 : -1;
+    }
   
   Mat src = imread(inputFileName, 0);
   if(src.empty())
@@ -131,53 +309,25 @@ int main( int argc, char** argv )
   
  
   Mat dst, cdst;
-  Canny(src, dst, 50, 200, 3);
-  cvtColor(dst, cdst, cv::COLOR_GRAY2BGR);
-  bool outLines = outputFileName.size()!=0;
-  ofstream outStream;
-  if(outLines)
+  vector<Vec4i> segments = detectLines(src, dst, params);
+  if(outputFileName.size()!=0)
     {
-      outStream.open(outputFileName.c_str(), ofstream::binary);
+      exportSegments(segments, outputFileName);
     }
   
-  if(useProbabilist){
-    vector<Vec2f> lines;
-    HoughLines(dst, lines, rho, theta, threshold, 0, 0 );
-    
-    for( size_t i = 0; i < lines.size(); i++ )
-      {
-        float rho = lines[i][0], theta = lines[i][1];
-        Point pt1, pt2;
-        double a = cos(theta), b = sin(theta);
-        double x0 = a*rho, y0 = b*rho;
-        pt1.x = cvRound(x0 + 1000*(-b));
-        pt1.y = cvRound(y0 + 1000*(a));
-        pt2.x = cvRound(x0 - 1000*(-b));
-        pt2.y = cvRound(y0 - 1000*(a));
-        line( cdst, pt1, pt2, Scalar(0,0,255), 1, LINE_AA);
-        if(outLines){
-          outStream << pt1.x << " " << pt1.y << " " << pt2.x << " " << pt2.y << std::endl;
-        }
-      }
-  }
-  else
+  if(!noDisplay)
     {
-      vector<Vec4i> lines;
-      HoughLinesP(dst, lines, rho, theta, threshold, minLength, maxLineGap );
-      for( size_t i = 0; i < lines.size(); i++ )
+      cvtColor(dst, cdst, cv::COLOR_GRAY2BGR);
+      for( size_t i = 0; i < segments.size(); i++ )
         {
-          Vec4i l = lines[i];
+          Vec4i l = segments[i];
           line( cdst, Point(l[0], l[1]), Point(l[2], l[3]), Scalar(0,0,255), 1, LINE_AA);
-          if(outLines){
-            outStream << l[0] << " " << l[1] << " " << l[2] << " " << l[3] << std::endl;
-          }        
         }
+      imshow("source", src);
+      imshow("detected lines", cdst);
+      waitKey();
     }
   
-  imshow("source", src);
-  imshow("detected lines", cdst);
-  waitKey();
-  
   return 0;
 }
 
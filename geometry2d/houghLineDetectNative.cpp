@@ -0,0 +1,454 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+/**
+ * @file houghLineDetectNative.cpp
+ * @ingroup geometry2d
+ *
+ * @date 2026/10/18
+ *
+ * Source file of the tool houghLineDetectNative
+ *
+ * This file is part of the DGtal library/DGtalTools-contrib Project.
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+#include "DGtal/base/Common.h"
+#include "DGtal/helpers/StdDefs.h"
+#include "DGtal/images/ImageContainerBySTLVector.h"
+#include "DGtal/io/readers/GenericReader.h"
+#include "DGtal/io/readers/PointListReader.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "CLI11.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+using namespace std;
+using namespace DGtal;
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ @page houghLineDetectNative houghLineDetectNative
+
+ @brief  Line detection with a Hough transform which does not depend on OpenCV.
+
+ The edge points are given either as an edge image (all the pixels with
+ value greater or equal to --edgeThreshold) or as a list of points
+ (.sdp). The lines are represented by (rho, theta) with rho = x
+ cos(theta) + y sin(theta) (as in the OpenCV implementation used by
+ houghLineDetect). The sin/cos values of the theta bins are precomputed,
+ each thread votes in its own accumulator (the rho indices of a point for
+ all the theta bins are computed in a vectorized loop) and the
+ accumulators are summed. The lines are the accumulator cells with at
+ least --threshold votes which are maximal in their neighborhood (non
+ maximum suppression). With --pyramid, the votes are first done in a
+ coarse accumulator and each coarse peak is then refined in a small
+ window of the full resolution accumulator, in which only the points
+ close to the coarse line vote. The pyramid pays off on large inputs
+ (many edge points, fine resolutions) with few coarse peaks; with many
+ peaks the full resolution vote is faster.
+
+ @b Usage:   houghLineDetectNative [input]
+
+ @b Allowed @b options @b are :
+
+ @code
+ Positionals:
+   1 TEXT:FILE REQUIRED                  the input edge image or the input edge points (.sdp).
+
+ Options:
+   -h,--help                             Print this help message and exit
+   -i,--input TEXT:FILE REQUIRED         the input edge image or the input edge points (.sdp).
+   -o,--output TEXT                      the output file containing the resulting lines segments (one segment per lines).
+   -r,--rho FLOAT=1                      The resolution of the parameter r in pixels.
+   -t,--theta FLOAT=0.0174533            The resolution of the parameter theta in radians.
+   -T,--threshold UINT=100               The minimum number of votes to detect a line.
+   -e,--edgeThreshold UINT=128           The minimal value of the edge pixels (for image input).
+   -n,--nmsSize UINT=2                   The half size of the neighborhood used in the non maximum suppression.
+   -M,--maxLines UINT=0                  The maximal number of lines (0: no limit).
+   -p,--pyramid UINT=0                   Use a coarse accumulator with resolution reduced by this factor before refining the peaks at full resolution (0 or 1: no pyramid); it pays off on large inputs with few peaks.
+   --threads UINT=0                      number of threads (0: default number of threads).
+ @endcode
+
+ @b Example:
+
+ @code
+   houghLineDetectNative -i edges.pgm -T 100 -o lines.txt
+ @endcode
+
+ @see
+ @ref houghLineDetectNative.cpp
+
+ */
+
+
+struct HoughLine
+{
+  double rho;
+  double theta;
+  unsigned int votes;
+};
+
+
+/**
+ * Hough accumulator defined on a (theta, rho) window. The votes are
+ * done in parallel in one accumulator per thread.
+ */
+class HoughAccumulator
+{
+public:
+  /**
+   * @param thetaMin the first theta value.
+   * @param thetaRes the resolution of theta.
+   * @param nbTheta the number of theta bins.
+   * @param rhoMin the first rho value.
+   * @param rhoRes the resolution of rho.
+   * @param nbRho the number of rho bins.
+   */
+  HoughAccumulator(double thetaMin, double thetaRes, unsigned int nbTheta,
+                   double rhoMin, double rhoRes, unsigned int nbRho):
+    myThetaMin(thetaMin), myThetaRes(thetaRes), myNbTheta(nbTheta),
+    myRhoMin(rhoMin), myRhoRes(rhoRes), myNbRho(nbRho),
+    myCos(nbTheta), mySin(nbTheta),
+    myAcc(static_cast<std::size_t>(nbTheta)*nbRho, 0)
+  {
+    for (unsigned int t = 0; t < myNbTheta; t++){
+      myCos[t] = static_cast<float>(std::cos(myThetaMin + t*myThetaRes));
+      mySin[t] = static_cast<float>(std::sin(myThetaMin + t*myThetaRes));
+    }
+  }
+
+  /**
+   * Adds the votes of the given points (the points with rho outside the
+   * accumulator window are ignored).
+   */
+  void vote(const std::vector<Z2i::RealPoint> &points){
+    const std::size_t accSize = myAcc.size();
+    const float invRho = static_cast<float>(1.0/myRhoRes);
+    const float rhoOrigin = static_cast<float>(-myRhoMin/myRhoRes + 0.5);
+    const float nbRho = static_cast<float>(myNbRho);
+    const long long n = static_cast<long long>(points.size());
+    int nbThreads = 1;
+#ifdef _OPENMP
+    nbThreads = omp_in_parallel() ? 1 : omp_get_max_threads();
+#endif
+    std::vector<std::vector<unsigned int>> threadAcc (nbThreads, std::vector<unsigned int>(accSize, 0));
+#pragma omp parallel num_threads(nbThreads)
+    {
+      int idThread = 0;
+#ifdef _OPENMP
+      idThread = omp_get_thread_num();
+#endif
+      std::vector<unsigned int> &acc = threadAcc[idThread];
+      std::vector<float> rhoPos (myNbTheta);
+      const float *cosTab = myCos.data();
+      const float *sinTab = mySin.data();
+      float *pos = rhoPos.data();
+#pragma omp for schedule(static)
+      for (long long i = 0; i < n; i++){
+        const float x = static_cast<float>(points[i][0]);
+        const float y = static_cast<float>(points[i][1]);
+#pragma omp simd
+        for (unsigned int t = 0; t < myNbTheta; t++){
+          pos[t] = (x*cosTab[t] + y*sinTab[t])*invRho + rhoOrigin;
+        }
+        for (unsigned int t = 0; t < myNbTheta; t++){
+          if (pos[t] >= 0.0f && pos[t] < nbRho){
+            acc[static_cast<std::size_t>(t)*myNbRho + static_cast<unsigned int>(pos[t])]++;
+          }
+        }
+      }
+    }
+    // reduction of the thread accumulators
+    const long long size = static_cast<long long>(accSize);
+#pragma omp parallel for schedule(static) num_threads(nbThreads)
+    for (long long c = 0; c < size; c++){
+      unsigned int sum = myAcc[c];
+      for (int k = 0; k < nbThreads; k++){
+        sum += threadAcc[k][c];
+      }
+      myAcc[c] = sum;
+    }
+  }
+
+  /**
+   * Extracts the cells having at least aThreshold votes and which are
+   * maximal in their (2 aNmsSize + 1)^2 neighborhood (on a plateau,
+   * only the first cell in the scan order is kept).
+   */
+  std::vector<HoughLine> peaks(unsigned int aThreshold, unsigned int aNmsSize) const {
+    std::vector<HoughLine> res;
+    const int s = static_cast<int>(aNmsSize);
+    const long long nbTheta = static_cast<long long>(myNbTheta);
+#pragma omp parallel
+    {
+      std::vector<HoughLine> localRes;
+#pragma omp for schedule(dynamic) nowait
+      for (long long t = 0; t < nbTheta; t++){
+        for (int r = 0; r < static_cast<int>(myNbRho); r++){
+          const unsigned int v = cell(t, r);
+          if (v < aThreshold) continue;
+          bool isMax = true;
+          for (int dt = -s; dt <= s && isMax; dt++){
+            const long long tt = t + dt;
+            if (tt < 0 || tt >= nbTheta) continue;
+            for (int dr = -s; dr <= s; dr++){
+              const int rr = r + dr;
+              if (rr < 0 || rr >= static_cast<int>(myNbRho) || (dt == 0 && dr == 0)) continue;
+              const unsigned int vn = cell(tt, rr);
+              const bool before = dt < 0 || (dt == 0 && dr < 0);
+              if (vn > v || (before && vn == v)){
+                isMax = false;
+                break;
+              }
+            }
+          }
+          if (isMax){
+            localRes.push_back({myRhoMin + r*myRhoRes, myThetaMin + t*myThetaRes, v});
+          }
+        }
+      }
+#pragma omp critical
+      res.insert(res.end(), localRes.begin(), localRes.end());
+    }
+    sortLines(res);
+    return res;
+  }
+
+  /**
+   * @return the cell with the maximal number of votes.
+   */
+  HoughLine maxCell() const {
+    auto it = std::max_element(myAcc.begin(), myAcc.end());
+    const std::size_t i = std::distance(myAcc.begin(), it);
+    return {myRhoMin + (i % myNbRho)*myRhoRes, myThetaMin + (i / myNbRho)*myThetaRes, *it};
+  }
+
+  static void sortLines(std::vector<HoughLine> &lines){
+    std::sort(lines.begin(), lines.end(), [](const HoughLine &a, const HoughLine &b){
+      return a.votes > b.votes || (a.votes == b.votes &&
+                                   (a.theta < b.theta || (a.theta == b.theta && a.rho < b.rho)));
+    });
+  }
+
+private:
+  unsigned int cell(long long t, int r) const {
+    return myAcc[static_cast<std::size_t>(t)*myNbRho + r];
+  }
+
+  double myThetaMin;
+  double myThetaRes;
+  unsigned int myNbTheta;
+  double myRhoMin;
+  double myRhoRes;
+  unsigned int myNbRho;
+  std::vector<float> myCos;
+  std::vector<float> mySin;
+  std::vector<unsigned int> myAcc;
+};
+
+
+
+/**
+ * Detects the lines from the full resolution accumulator.
+ */
+static
+std::vector<HoughLine>
+detectLines(const std::vector<Z2i::RealPoint> &points, double rhoMax,
+            double rhoRes, double thetaRes, unsigned int threshold, unsigned int nmsSize)
+{
+  const unsigned int nbTheta = static_cast<unsigned int>(std::ceil(M_PI/thetaRes));
+  const unsigned int nbRho = static_cast<unsigned int>(std::ceil(2.0*rhoMax/rhoRes)) + 1;
+  HoughAccumulator acc (0.0, thetaRes, nbTheta, -rhoMax, rhoRes, nbRho);
+  acc.vote(points);
+  return acc.peaks(threshold, nmsSize);
+}
+
+
+/**
+ * Detects the lines in a coarse accumulator (resolutions multiplied by
+ * aFactor) and refines each coarse peak in a full resolution window
+ * covering the coarse cell. Only the points which can vote in the
+ * window are used: along the window, the rho of a point p moves of at
+ * most |dtheta| ||p|| from its rho at the coarse theta.
+ */
+static
+std::vector<HoughLine>
+detectLinesPyramid(const std::vector<Z2i::RealPoint> &points, double rhoMax,
+                   double rhoRes, double thetaRes, unsigned int threshold,
+                   unsigned int nmsSize, unsigned int aFactor)
+{
+  const double coarseRhoRes = rhoRes*aFactor;
+  const double coarseThetaRes = thetaRes*aFactor;
+  std::vector<HoughLine> coarseLines = detectLines(points, rhoMax, coarseRhoRes, coarseThetaRes,
+                                                   threshold, nmsSize);
+  trace.info() << "Coarse peaks: " << coarseLines.size() << std::endl;
+  std::vector<HoughLine> res (coarseLines.size());
+  std::vector<char> valid (coarseLines.size(), 0);
+  const long long nbCoarse = static_cast<long long>(coarseLines.size());
+  const unsigned int nbTheta = 2*aFactor + 1;
+  const unsigned int nbRho = 2*aFactor + 1;
+#pragma omp parallel for schedule(dynamic)
+  for (long long i = 0; i < nbCoarse; i++){
+    const HoughLine &l = coarseLines[i];
+    HoughAccumulator acc (l.theta - aFactor*thetaRes, thetaRes, nbTheta,
+                          l.rho - aFactor*rhoRes, rhoRes, nbRho);
+    const double c = std::cos(l.theta);
+    const double s = std::sin(l.theta);
+    const double rhoMargin = (aFactor + 2)*rhoRes;
+    const double thetaSpan = aFactor*thetaRes;
+    std::vector<Z2i::RealPoint> nearPoints;
+    for (const auto &p: points){
+      if (std::abs(p[0]*c + p[1]*s - l.rho) <= rhoMargin + thetaSpan*p.norm()){
+        nearPoints.push_back(p);
+      }
+    }
+    acc.vote(nearPoints);
+    res[i] = acc.maxCell();
+    valid[i] = res[i].votes >= threshold;
+    // back to theta in [0, pi)
+    if (res[i].theta < 0.0 || res[i].theta >= M_PI - thetaRes/2.0){
+      res[i].theta += res[i].theta < 0.0 ? M_PI : -M_PI;
+      res[i].rho = -res[i].rho;
+    }
+  }
+  // removes the refined lines which are duplicated.
+  std::vector<HoughLine> lines;
+  for (long long i = 0; i < nbCoarse; i++){
+    if (!valid[i]) continue;
+    bool dup = false;
+    for (const auto &l: lines){
+      if (std::abs(l.rho - res[i].rho) < rhoRes/2.0 && std::abs(l.theta - res[i].theta) < thetaRes/2.0){
+        dup = true;
+        break;
+      }
+    }
+    if (!dup) lines.push_back(res[i]);
+  }
+  HoughAccumulator::sortLines(lines);
+  return lines;
+}
+
+
+
+int main( int argc, char** argv )
+{
+  typedef ImageContainerBySTLVector<Z2i::Domain, unsigned char> Image2D;
+
+  // parse command line using CLI ----------------------------------------------
+  CLI::App app;
+  std::string inputFileName;
+  std::string outputFileName;
+  double rho {1.0};
+  double theta {M_PI/180.0};
+  unsigned int threshold {100};
+  unsigned int edgeThreshold {128};
+  unsigned int nmsSize {2};
+  unsigned int maxLines {0};
+  unsigned int pyramid {0};
+  unsigned int nbThreads {0};
+
+  app.description("Line detection with a Hough transform (without OpenCV) from an edge image or a set of edge points.\n"
+                  "Typical use example:\n \t houghLineDetectNative -i edges.pgm -T 100 -o lines.txt \n");
+  app.add_option("-i,--input,1", inputFileName, "the input edge image or the input edge points (.sdp)." )
+  ->required()
+  ->check(CLI::ExistingFile);
+  app.add_option("--output,-o", outputFileName,  "the output file containing the resulting lines segments (one segment per lines).");
+  app.add_option("--rho,-r", rho,  "The resolution of the parameter r in pixels." )
+  ->check(CLI::PositiveNumber);
+  app.add_option("--theta,-t", theta, "The resolution of the parameter theta in radians." )
+  ->check(CLI::PositiveNumber);
+  app.add_option("--threshold,-T", threshold, "The minimum number of votes to detect a line.");
+  app.add_option("--edgeThreshold,-e", edgeThreshold, "The minimal value of the edge pixels (for image input).");
+  app.add_option("--nmsSize,-n", nmsSize, "The half size of the neighborhood used in the non maximum suppression.");
+  app.add_option("--maxLines,-M", maxLines, "The maximal number of lines (0: no limit).");
+  app.add_option("--pyramid,-p", pyramid, "Use a coarse accumulator with resolution reduced by this factor before refining the peaks at full resolution (0 or 1: no pyramid); it pays off on large inputs with few peaks.");
+  app.add_option("--threads", nbThreads, "number of threads (0: default number of threads).");
+
+  app.get_formatter()->column_width(40);
+  CLI11_PARSE(app, argc, argv);
+  // END parse command line using CLI ----------------------------------------------
+
+#ifdef _OPENMP
+  if (nbThreads != 0)
+    {
+      omp_set_num_threads(nbThreads);
+    }
+#endif
+
+  std::vector<Z2i::RealPoint> points;
+  std::string extension = inputFileName.substr(inputFileName.find_last_of(".") + 1);
+  if (extension == "sdp" || extension == "txt" || extension == "dat")
+    {
+      points = PointListReader<Z2i::RealPoint>::getPointsFromFile(inputFileName);
+    }
+  else
+    {
+      Image2D image = GenericReader<Image2D>::import(inputFileName);
+      for (auto p: image.domain())
+        {
+          if (image(p) >= edgeThreshold)
+            {
+              points.push_back(Z2i::RealPoint(p[0], p[1]));
+            }
+        }
+    }
+  trace.info() << "Number of edge points: " << points.size() << std::endl;
+
+  double rhoMax = 1.0;
+  for (const auto &p: points)
+    {
+      rhoMax = std::max(rhoMax, p.norm());
+    }
+  rhoMax = std::ceil(rhoMax);
+
+  trace.beginBlock("Hough transform");
+  std::vector<HoughLine> lines = pyramid > 1 ?
+    detectLinesPyramid(points, rhoMax, rho, theta, threshold, nmsSize, pyramid) :
+    detectLines(points, rhoMax, rho, theta, threshold, nmsSize);
+  trace.endBlock();
+  if (maxLines != 0 && lines.size() > maxLines)
+    {
+      lines.resize(maxLines);
+    }
+  trace.info() << "Number of detected lines: " << lines.size() << std::endl;
+
+  if(outputFileName.size() != 0)
+    {
+      ofstream outStream;
+      outStream.open(outputFileName.c_str());
+      for (const auto &l: lines)
+        {
+          double a = cos(l.theta), b = sin(l.theta);
+          double x0 = a*l.rho, y0 = b*l.rho;
+          outStream << std::round(x0 + rhoMax*(-b)) << " " << std::round(y0 + rhoMax*(a)) << " "
+                    << std::round(x0 - rhoMax*(-b)) << " " << std::round(y0 - rhoMax*(a)) << std::endl;
+        }
+      outStream.close();
+    }
+  return 0;
+}
+
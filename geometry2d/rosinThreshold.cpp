@@ -37,9 +37,16 @@
 #include "DGtal/base/Common.h"
 #include "DGtal/io/readers/PointListReader.h"
 #include <DGtal/io/readers/TableReader.h>
+#include <DGtal/io/readers/GenericReader.h>
+#include <DGtal/io/writers/GenericWriter.h>
+#include <DGtal/images/ImageContainerBySTLVector.h>
 #include <DGtal/math/Statistic.h>
 
 #include <math.h>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <set>
 
 #include "CLI11.hpp"
 
@@ -54,6 +61,13 @@ using namespace DGtal;
  
  @brief  Apply the Rosin Threshold algorithm.
 
+ The input can be a simple text file of data values (one column is
+ selected with --dataIndex) or directly a 2D/3D image readable by the
+ DGtal GenericReader (pgm, vol, longvol, pgm3d). For images, the
+ intensity histogram is built directly from the image buffer (with one
+ partial histogram per thread when OpenMP is available) and the
+ thresholded binary image can be exported with --outputImage.
+
  @b Usage:   rosinThreshold [input]
 
  @b Allowed @b options @b are :
@@ -61,19 +75,21 @@ using namespace DGtal;
  @code
  
  Positionals:
-   1 TEXT:FILE REQUIRED                  an input file.
+   1 TEXT:FILE REQUIRED                  an input file (text data file or 2D/3D image).
 
  Options:
    -h,--help                             Print this help message and exit
-   -i,--input TEXT:FILE REQUIRED         an input file.
+   -i,--input TEXT:FILE REQUIRED         an input file (text data file or 2D/3D image).
    -d,--dataIndex UINT=0                 the index to read input data.
    -b,--binSize FLOAT=1                  binSize for the x axis.
+   -o,--outputImage TEXT                 export the thresholded binary image (only with image input): voxels with value greater than the threshold are set to 255.
 @endcode
 
  @b Example: 
 
  @code
    	rosinThreshold -i  $DGtal/examples/samples/....
+   	rosinThreshold -i  $DGtal/examples/samples/lobster.vol -o lobsterThr.vol
  @endcode
 
  @image html resrosinThreshold.png "Example of result. "
@@ -83,6 +99,30 @@ using namespace DGtal;
 
  */
 
+typedef ImageContainerBySTLVector<Z2i::Domain, unsigned int> Image2D;
+typedef ImageContainerBySTLVector<Z3i::Domain, unsigned int> Image3D;
+typedef std::vector<DGtal::uint64_t> Histogram;
+
+
+static std::string
+fileExtension(const std::string &filename){
+  return filename.substr(filename.find_last_of(".") + 1);
+}
+
+// only grayscale 2D images: the other formats (ppm, png...) would be read
+// as packed RGB values in an unsigned int image.
+static bool
+isImage2DFile(const std::string &filename){
+  static const std::set<std::string> ext2D {"pgm"};
+  return ext2D.count(fileExtension(filename)) != 0;
+}
+
+static bool
+isImage3DFile(const std::string &filename){
+  static const std::set<std::string> ext3D {"vol", "longvol", "pgm3d", "pgm3D", "p3d"};
+  return ext3D.count(fileExtension(filename)) != 0;
+}
+
 
 
 void
@@ -97,26 +137,80 @@ export2Text(const std::vector<std::pair<double, double> > &v, const std::string
 }
 
 
+/**
+ * Builds the histogram of the values given by a random access iterator.
+ * The values are scanned by contiguous slabs (one per thread) each
+ * filling its own partial histogram, the partial histograms are then
+ * summed.
+ *
+ * @param first iterator on the first value.
+ * @param nbValues the number of values.
+ * @param binSize the size of a bin.
+ * @param[out] minValue the value associated to the first bin.
+ * @return the histogram (empty if there is no value).
+ */
+template<typename TIterator>
+Histogram
+computeHistogram(TIterator first, std::size_t nbValues, double binSize, double &minValue){
+    if (nbValues == 0){
+        trace.error() << "no value to threshold: the input is empty." << std::endl;
+        minValue = 0.0;
+        return Histogram();
+    }
+    double maxValue = static_cast<double>(*first);
+    minValue = maxValue;
+    const long long n = static_cast<long long>(nbValues);
+#pragma omp parallel
+    {
+        double localMin = minValue;
+        double localMax = maxValue;
+#pragma omp for schedule(static) nowait
+        for(long long i = 0; i < n; i++){
+            const double v = static_cast<double>(first[i]);
+            localMin = std::min(localMin, v);
+            localMax = std::max(localMax, v);
+        }
+#pragma omp critical
+        {
+            minValue = std::min(minValue, localMin);
+            maxValue = std::max(maxValue, localMax);
+        }
+    }
+    const std::size_t nbInterval = static_cast<std::size_t>((maxValue - minValue) / binSize) + 1;
+    Histogram histogram(nbInterval, 0);
+    const double minV = minValue;
+#pragma omp parallel
+    {
+        Histogram localHistogram(nbInterval, 0);
+#pragma omp for schedule(static) nowait
+        for(long long i = 0; i < n; i++){
+            std::size_t index = static_cast<std::size_t>((static_cast<double>(first[i]) - minV) / binSize);
+            localHistogram[std::min(index, nbInterval - 1)]++;
+        }
+#pragma omp critical
+        for(std::size_t i = 0; i < nbInterval; i++){
+            histogram[i] += localHistogram[i];
+        }
+    }
+    return histogram;
+}
+
+
+/**
+ * @return the Rosin threshold of a histogram (nan if it is empty).
+ */
 double
-getThresholdByRosin(const std::vector<double> &data, double binSize){
-    //build histogram
-    double maxValue = *std::max_element(data.begin(), data.end());
-    double minValue = *std::min_element(data.begin(), data.end());
-    double range = maxValue - minValue;
-    int nbInterval = range / binSize;
-
-    std::vector<int> histogram(nbInterval, 0);
-    for(unsigned int i = 0; i < data.size(); i++){
-        int index = (data.at(i) - minValue)/binSize;
-        histogram[index]++;
+getThresholdByRosin(const Histogram &histogram, double minValue, double binSize){
+    if (histogram.empty()){
+        return std::numeric_limits<double>::quiet_NaN();
     }
-    std::vector<int>::iterator maxFreq = std::max_element(histogram.begin(), histogram.end());
-    int maxFreqValue = *maxFreq;
-    int maxFreqIndex = std::distance(histogram.begin(), maxFreq);
+    Histogram::const_iterator maxFreq = std::max_element(histogram.begin(), histogram.end());
+    double maxFreqValue = static_cast<double>(*maxFreq);
+    unsigned int maxFreqIndex = std::distance(histogram.begin(), maxFreq);
     assert(maxFreqValue == histogram.at(maxFreqIndex));
    
     unsigned int lastIndex = histogram.size() - 1;
-    int lastValue = histogram.at(lastIndex);
+    double lastValue = static_cast<double>(histogram.at(lastIndex));
    
     
     for(unsigned int i = maxFreqIndex; i < histogram.size(); i++)
@@ -130,12 +224,12 @@ getThresholdByRosin(const std::vector<double> &data, double binSize){
       }
     double valueDiff = lastValue - maxFreqValue;
     double valueDiff2 = valueDiff *valueDiff;
-    double indexDiff = lastIndex - maxFreqIndex;
+    double indexDiff = static_cast<double>(lastIndex) - maxFreqIndex;
     double indexDiff2 = indexDiff * indexDiff;
     double bestThresIndex = maxFreqIndex;
     double bestDist = 0;
     //line between maxFreq and last element of historgram
-    double a = (lastValue - maxFreqValue)*1.0/(lastIndex - maxFreqIndex);
+    double a = (lastValue - maxFreqValue)*1.0/(indexDiff);
     double b = maxFreqValue - a * maxFreqIndex;
     
     for (unsigned int i = maxFreqIndex; i < lastIndex; i++)
@@ -160,7 +254,7 @@ getThresholdByRosin(const std::vector<double> &data, double binSize){
     */
 
     
-    int bestVal = histogram.at(bestThresIndex);
+    double bestVal = static_cast<double>(histogram.at(bestThresIndex));
     double x2 = (bestVal + bestThresIndex/a - b)/(a + 1/a);
     double y2 = b + a*x2;
     std::vector<std::pair<double, double>> forPlot;
@@ -187,6 +281,46 @@ getThresholdByRosin(const std::vector<double> &data, double binSize){
 }
 
 
+double
+getThresholdByRosin(const std::vector<double> &data, double binSize){
+    double minValue;
+    Histogram histogram = computeHistogram(data.begin(), data.size(), binSize, minValue);
+    return getThresholdByRosin(histogram, minValue, binSize);
+}
+
+
+/**
+ * Applies the Rosin threshold on the image values and exports
+ * optionally the resulting binary image (255 for values greater than
+ * the threshold).
+ */
+template<typename TImage>
+double
+processImage(const std::string &inputFileName, const std::string &outputFileName, double binSize){
+    typedef ImageContainerBySTLVector<typename TImage::Domain, unsigned char> BinaryImage;
+    trace.info() << "Reading input image " << inputFileName << " ...";
+    TImage image = GenericReader<TImage>::import(inputFileName);
+    trace.info() << " [done]" << std::endl;
+    const std::size_t nbValues = image.domain().size();
+    double minValue;
+    Histogram histogram = computeHistogram(image.begin(), nbValues, binSize, minValue);
+    double threshold = getThresholdByRosin(histogram, minValue, binSize);
+    if (outputFileName != "" && !std::isnan(threshold)){
+        BinaryImage imageRes(image.domain());
+        auto itIn = image.begin();
+        auto itOut = imageRes.begin();
+        const long long n = static_cast<long long>(nbValues);
+#pragma omp parallel for schedule(static)
+        for(long long i = 0; i < n; i++){
+            itOut[i] = itIn[i] > threshold ? 255 : 0;
+        }
+        trace.info() << "Exporting thresholded image in " << outputFileName << std::endl;
+        GenericWriter<BinaryImage>::exportFile(outputFileName, imageRes);
+    }
+    return threshold;
+}
+
+
 
 int main( int argc, char** argv )
 {
@@ -195,17 +329,19 @@ int main( int argc, char** argv )
   // parse command line using CLI ----------------------------------------------
   CLI::App app;
   std::string inputFileName;
-  app.description("Applies the Rosin Treshold on an image.");
+  std::string outputImageFileName {""};
+  app.description("Applies the Rosin Treshold on a text data file or directly on a 2D/3D image (pgm, vol, longvol, pgm3d).");
   
   double binSize {1.0};
   unsigned int indexData {0};
   
   
-  app.add_option("-i,--input,1", inputFileName, "an input file." )
+  app.add_option("-i,--input,1", inputFileName, "an input file (text data file or 2D/3D image)." )
       ->required()
       ->check(CLI::ExistingFile);
   app.add_option("-d,--dataIndex",indexData, "the index to read input data.");
   app.add_option("--binSize,-b", binSize, "binSize for the x axis.");
+  app.add_option("--outputImage,-o", outputImageFileName, "export the thresholded binary image (only with image input): voxels with value greater than the threshold are set to 255.");
     
   app.get_formatter()->column_width(40);
   CLI11_PARSE(app, argc, argv);
@@ -213,8 +349,23 @@ int main( int argc, char** argv )
 
   // Some nice processing  --------------------------------------------------
   
-  std::vector<double> vectData = TableReader<double>::getColumnElementsFromFile(inputFileName, indexData);
-  double value = getThresholdByRosin(vectData, binSize);  
+  double value;
+  if (isImage3DFile(inputFileName)){
+    value = processImage<Image3D>(inputFileName, outputImageFileName, binSize);
+  }
+  else if (isImage2DFile(inputFileName)){
+    value = processImage<Image2D>(inputFileName, outputImageFileName, binSize);
+  }
+  else{
+    if (outputImageFileName != ""){
+      trace.warning() << "output image ignored: the input is not an image." << std::endl;
+    }
+    std::vector<double> vectData = TableReader<double>::getColumnElementsFromFile(inputFileName, indexData);
+    value = getThresholdByRosin(vectData, binSize);
+  }
+  if (std::isnan(value)){
+    return 1;
+  }
   DGtal::trace.info() << "Rosin Threshold: " << value << std::endl;
 
   return 0;
@@ -0,0 +1,384 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+/**
+ * @file rosinThresholdStream.cpp
+ * @ingroup geometry2d
+ *
+ * @date 2026/10/18
+ *
+ * Source file of the tool rosinThresholdStream
+ *
+ * This file is part of the DGtal library/DGtalTools-contrib Project.
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+#include "DGtal/base/Common.h"
+
+#include <iostream>
+#include <vector>
+#include <limits>
+#include <cmath>
+
+#include "CLI11.hpp"
+
+
+///////////////////////////////////////////////////////////////////////////////
+using namespace std;
+using namespace DGtal;
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ @page rosinThresholdStream rosinThresholdStream
+
+ @brief  Apply the Rosin Threshold algorithm on a sliding window of a stream of values.
+
+ The values are read from the standard input and the histogram of the
+ last N values (--windowSize) is updated incrementally. After each step
+ (--step values) the Rosin threshold of the window is written on the
+ standard output (one value per line). The Rosin point is defined as in
+ the rosinThreshold tool: the bin maximizing the distance to the line
+ joining the histogram peak and the first empty bin after the peak (or
+ the last bin). If the stream ends before the window is full, the
+ threshold of the partial window is written.
+
+ The peak and the first empty bin are maintained with segment trees in
+ O(log(nbBins)) per value, as well as the maximal distance to the line
+ while the line does not move (only the two modified bins are
+ re-evaluated). When the peak (its bin or its count) or the first empty
+ bin changes, every distance of the interval [peak, last) changes: this
+ interval is then re-evaluated in O(last - peak), once when the next
+ threshold is written (not for each value). Since the peak count changes
+ for most values in a usual stream, the cost is close to O(last - peak)
+ per written threshold, plus O(log(nbBins)) per value.
+
+ Since the stream range is not known in advance, the bins are fixed by
+ the options --minValue, --binSize and --nbBins (values outside are
+ clamped in the first or last bin).
+
+ @b Usage:   rosinThresholdStream [options] < input
+
+ @b Allowed @b options @b are :
+
+ @code
+ Options:
+   -h,--help                             Print this help message and exit
+   -w,--windowSize UINT=1000             the number of values of the sliding window.
+   -s,--step UINT=1                      the number of values read between two thresholds.
+   -m,--minValue FLOAT=0                 the value associated to the first bin.
+   -b,--binSize FLOAT=1                  binSize for the x axis.
+   -n,--nbBins UINT=256                  the number of bins of the histogram.
+@endcode
+
+ @b Example:
+
+ @code
+   acquisition | rosinThresholdStream -w 5000 -s 100 -n 4096
+ @endcode
+
+ @see
+ @ref rosinThresholdStream.cpp
+
+ */
+
+
+/**
+ * Histogram of a sliding window of values giving the Rosin threshold
+ * with incremental updates.
+ */
+class SlidingRosinHistogram
+{
+public:
+  SlidingRosinHistogram(double minValue, double binSize,
+                        unsigned int nbBins, unsigned int windowSize):
+    myMinValue(minValue), myBinSize(binSize), myNbBins(nbBins),
+    myWindow(windowSize, 0), myWindowPos(0), myNbValues(0),
+    myCounts(nbBins, 0), myPeak(0), myLast(0),
+    myPeakValue(0), myLastValue(0), myDistPeak(0), myDistLast(0), myIsDirty(false)
+  {
+    myTreeSize = 1;
+    while (myTreeSize < myNbBins) myTreeSize *= 2;
+    myMaxTree.resize(2*myTreeSize, -1);
+    myMaxIndex.resize(2*myTreeSize, 0);
+    myMinTree.resize(2*myTreeSize, std::numeric_limits<long long>::max());
+    myDistTree.resize(2*myTreeSize, -1.0);
+    myDistIndex.resize(2*myTreeSize, 0);
+    for (unsigned int i = 0; i < myTreeSize; i++){
+      myMaxIndex[myTreeSize+i] = i;
+      myDistIndex[myTreeSize+i] = i;
+    }
+    for (unsigned int i = 0; i < myNbBins; i++){
+      myMaxTree[myTreeSize+i] = 0;
+      myMinTree[myTreeSize+i] = 0;
+    }
+    for (unsigned int i = myTreeSize-1; i > 0; i--){
+      pullCounts(i);
+    }
+    myLast = myNbBins > 1 ? 1 : 0;
+    myDistLast = myLast;
+  }
+
+  /**
+   * Adds a value in the window (the oldest value is removed if the window is full).
+   */
+  void push(double aValue){
+    unsigned int bin = binIndex(aValue);
+    if (isFull()){
+      unsigned int oldBin = myWindow[myWindowPos];
+      if (oldBin == bin){
+        myWindowPos = (myWindowPos + 1) % myWindow.size();
+        return;
+      }
+      updateCount(oldBin, -1);
+      updateCount(bin, 1);
+      myWindow[myWindowPos] = bin;
+      myWindowPos = (myWindowPos + 1) % myWindow.size();
+      updateRosin(oldBin, bin);
+    }
+    else{
+      updateCount(bin, 1);
+      myWindow[myWindowPos] = bin;
+      myWindowPos = (myWindowPos + 1) % myWindow.size();
+      myNbValues++;
+      updateRosin(bin, bin);
+    }
+  }
+
+  bool isFull() const {
+    return myNbValues == myWindow.size();
+  }
+
+  std::size_t nbValues() const {
+    return myNbValues;
+  }
+
+  /**
+   * @return the Rosin threshold of the current window (the distances are
+   * re-evaluated if the line moved since the previous threshold).
+   */
+  double threshold() {
+    if (myIsDirty){
+      refreshDistances();
+    }
+    unsigned int best = myPeak;
+    if (myLast > myPeak && myDistTree[1] > 0){
+      best = myDistIndex[1];
+    }
+    return best*myBinSize + myMinValue;
+  }
+
+private:
+  unsigned int binIndex(double aValue) const {
+    double i = std::floor((aValue - myMinValue)/myBinSize);
+    if (i < 0) return 0;
+    if (i >= myNbBins) return myNbBins - 1;
+    return static_cast<unsigned int>(i);
+  }
+
+  void pullCounts(unsigned int i){
+    const unsigned int l = 2*i, r = 2*i+1;
+    // left index on ties (as std::max_element)
+    if (myMaxTree[l] >= myMaxTree[r]){
+      myMaxTree[i] = myMaxTree[l];
+      myMaxIndex[i] = myMaxIndex[l];
+    }else{
+      myMaxTree[i] = myMaxTree[r];
+      myMaxIndex[i] = myMaxIndex[r];
+    }
+    myMinTree[i] = std::min(myMinTree[l], myMinTree[r]);
+  }
+
+  void pullDist(unsigned int i){
+    const unsigned int l = 2*i, r = 2*i+1;
+    if (myDistTree[l] >= myDistTree[r]){
+      myDistTree[i] = myDistTree[l];
+      myDistIndex[i] = myDistIndex[l];
+    }else{
+      myDistTree[i] = myDistTree[r];
+      myDistIndex[i] = myDistIndex[r];
+    }
+  }
+
+  void updateCount(unsigned int bin, int delta){
+    myCounts[bin] += delta;
+    unsigned int i = myTreeSize + bin;
+    myMaxTree[i] = myCounts[bin];
+    myMinTree[i] = myCounts[bin];
+    for (i /= 2; i > 0; i /= 2){
+      pullCounts(i);
+    }
+  }
+
+  /**
+   * @return the first empty bin with index greater than aStart (or
+   * the last bin).
+   */
+  unsigned int firstEmptyBin(unsigned int aStart) const {
+    unsigned int res = searchEmpty(1, 0, myTreeSize, aStart);
+    return res < myNbBins ? res : myNbBins - 1;
+  }
+
+  unsigned int searchEmpty(unsigned int node, unsigned int lo, unsigned int hi,
+                           unsigned int aStart) const {
+    if (hi <= aStart || myMinTree[node] != 0){
+      return myNbBins;
+    }
+    if (hi - lo == 1){
+      return lo;
+    }
+    unsigned int mid = (lo + hi)/2;
+    unsigned int res = searchEmpty(2*node, lo, mid, aStart);
+    if (res < myNbBins) return res;
+    return searchEmpty(2*node+1, mid, hi, aStart);
+  }
+
+  /// distance (up to the constant denominator) of a bin to the Rosin line.
+  double binDistance(unsigned int i) const {
+    double valueDiff = myLastValue - myPeakValue;
+    double indexDiff = static_cast<double>(myLast) - myPeak;
+    return std::abs(valueDiff*i - indexDiff*myCounts[i]
+                    + myPeakValue*myLast - myPeak*myLastValue);
+  }
+
+  void setDist(unsigned int bin, double aDist){
+    unsigned int i = myTreeSize + bin;
+    myDistTree[i] = aDist;
+    myDistIndex[i] = bin;
+  }
+
+  /// updates the internal nodes covering the leaves [lo, hi].
+  void pullDistRange(unsigned int lo, unsigned int hi){
+    lo += myTreeSize; hi += myTreeSize;
+    for (lo /= 2, hi /= 2; lo > 0; lo /= 2, hi /= 2){
+      for (unsigned int i = lo; i <= hi; i++){
+        pullDist(i);
+      }
+    }
+  }
+
+  void updateRosin(unsigned int removedBin, unsigned int addedBin){
+    unsigned int peak = myMaxIndex[1];
+    unsigned int last = firstEmptyBin(peak);
+    double peakValue = static_cast<double>(myCounts[peak]);
+    double lastValue = static_cast<double>(myCounts[last]);
+    if (peak != myPeak || last != myLast ||
+        peakValue != myPeakValue || lastValue != myLastValue){
+      // the line changed: the distances are re-evaluated by the next threshold.
+      myPeak = peak; myLast = last;
+      myPeakValue = peakValue; myLastValue = lastValue;
+      myIsDirty = true;
+    }
+    else if (!myIsDirty){
+      // only the modified bins are re-evaluated.
+      for (unsigned int bin : {removedBin, addedBin}){
+        if (bin >= myPeak && bin < myLast){
+          setDist(bin, binDistance(bin));
+          pullDistRange(bin, bin);
+        }
+      }
+    }
+  }
+
+  /// re-evaluates the distances of [peak, last) to the current line.
+  void refreshDistances(){
+    unsigned int lo = std::min(myPeak, myDistPeak);
+    unsigned int hi = std::max(myLast, myDistLast);
+    for (unsigned int i = myDistPeak; i < myDistLast; i++){
+      setDist(i, -1.0);
+    }
+    for (unsigned int i = myPeak; i < myLast; i++){
+      setDist(i, binDistance(i));
+    }
+    pullDistRange(lo, hi);
+    myDistPeak = myPeak;
+    myDistLast = myLast;
+    myIsDirty = false;
+  }
+
+  double myMinValue;
+  double myBinSize;
+  unsigned int myNbBins;
+  std::vector<unsigned int> myWindow;
+  std::size_t myWindowPos;
+  std::size_t myNbValues;
+  std::vector<long long> myCounts;
+
+  unsigned int myTreeSize;
+  std::vector<long long> myMaxTree;
+  std::vector<unsigned int> myMaxIndex;
+  std::vector<long long> myMinTree;
+  std::vector<double> myDistTree;
+  std::vector<unsigned int> myDistIndex;
+
+  unsigned int myPeak;
+  unsigned int myLast;
+  double myPeakValue;
+  double myLastValue;
+
+  // interval of the bins whose distances are in the tree, and true if the
+  // line moved since they were evaluated.
+  unsigned int myDistPeak;
+  unsigned int myDistLast;
+  bool myIsDirty;
+};
+
+
+
+int main( int argc, char** argv )
+{
+  // parse command line using CLI ----------------------------------------------
+  CLI::App app;
+  app.description("Applies the Rosin Treshold on a sliding window of the values read on the standard input and outputs one threshold per window step.\n"
+                  "Typical use example:\n \t acquisition | rosinThresholdStream -w 5000 -s 100 -n 4096 \n");
+
+  unsigned int windowSize {1000};
+  unsigned int step {1};
+  double minValue {0.0};
+  double binSize {1.0};
+  unsigned int nbBins {256};
+
+  app.add_option("--windowSize,-w", windowSize, "the number of values of the sliding window.")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--step,-s", step, "the number of values read between two thresholds.")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--minValue,-m", minValue, "the value associated to the first bin.");
+  app.add_option("--binSize,-b", binSize, "binSize for the x axis.")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--nbBins,-n", nbBins, "the number of bins of the histogram.")
+      ->check(CLI::PositiveNumber);
+
+  app.get_formatter()->column_width(40);
+  CLI11_PARSE(app, argc, argv);
+  // END parse command line using CLI ----------------------------------------------
+
+  SlidingRosinHistogram histogram (minValue, binSize, nbBins, windowSize);
+  double value;
+  unsigned int cpt = 0;
+  while (std::cin >> value){
+    histogram.push(value);
+    cpt++;
+    if (histogram.isFull() && cpt >= step){
+      std::cout << histogram.threshold() << std::endl;
+      cpt = 0;
+    }
+  }
+  // stream shorter than the window: threshold of the partial window.
+  if (!histogram.isFull() && histogram.nbValues() > 0){
+    std::cout << histogram.threshold() << std::endl;
+  }
+  return 0;
+}
+
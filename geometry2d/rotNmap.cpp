@@ -30,6 +30,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include <cmath>
 
 #include "DGtal/base/Common.h"
 #include "DGtal/helpers/StdDefs.h"
@@ -73,12 +75,205 @@ using namespace DGtal;
  -i,--input TEXT:FILE REQUIRED         Input file
  -o,--output TEXT REQUIRED             Output SDP filename
  -a,--angle FLOAT=3.14                 a double angle
+ -n,--onlyNormal                       rotate only normal not the map itself
+ -f,--fillFlat                         fill area with missing information by vertical normal (ie Color (128, 128, 255))
+ -b,--bilinear                         use bilinear interpolation instead of nearest neighbor to sample the input map.
+ --angles FLOAT ...                    apply several rotations from the same input: the result of the kth angle is exported in output_k.ext.
+ @endcode
+
+ The rotation is applied on the rows in parallel: the trigonometric
+ values are computed once per angle, the sampled positions are
+ incremented along each row and the normal vectors of a row are rotated
+ in a vectorized loop on planar buffers of the normal components.
+
+ @b Example:
+ @code
+ rotNmap normalMap.png normalRotated.png --angles 0.1 0.2 0.3 0.4 -b
  @endcode
  
  
  */
 
 
+typedef ImageContainerBySTLVector<Z2i::Domain, Color> ColorImage;
+
+
+/**
+ * Planar representation of a normal map: components of the normal
+ * vectors in [-1, 1] (from the red and green channels) and blue channel.
+ */
+struct NormalMapBuffer
+{
+  Z2i::Domain domain;
+  int width;
+  int height;
+  std::vector<float> nx;
+  std::vector<float> ny;
+  std::vector<float> blue;
+};
+
+
+static
+NormalMapBuffer
+unpackNormalMap(const ColorImage &anImage)
+{
+  NormalMapBuffer res;
+  res.domain = anImage.domain();
+  res.width = anImage.domain().upperBound()[0] - anImage.domain().lowerBound()[0] + 1;
+  res.height = anImage.domain().upperBound()[1] - anImage.domain().lowerBound()[1] + 1;
+  const long long size = static_cast<long long>(res.width)*res.height;
+  res.nx.resize(size);
+  res.ny.resize(size);
+  res.blue.resize(size);
+  auto it = anImage.begin();
+#pragma omp parallel for schedule(static)
+  for (long long i = 0; i < size; i++){
+    const Color &c = it[i];
+    res.nx[i] = (c.red()/255.0f)*2.0f - 1.0f;
+    res.ny[i] = (c.green()/255.0f)*2.0f - 1.0f;
+    res.blue[i] = c.blue();
+  }
+  return res;
+}
+
+
+static inline
+unsigned char
+encodeNormalComponent(float n)
+{
+  return static_cast<unsigned char>(std::max(0.0f, std::min(255.0f, (n + 1.0f)*128.0f)));
+}
+
+
+/**
+ * Rotates a normal map (position and normals) with the angle alpha.
+ *
+ * @param aMap the input normal map.
+ * @param alpha the rotation angle.
+ * @param onlyNormal if true only the normals are rotated.
+ * @param fillFlat if true the pixels without source are set to the vertical normal.
+ * @param bilinear if true the input is sampled with bilinear interpolation.
+ * @param[out] outputImage the resulting image (defined on the same domain).
+ */
+static
+void
+rotateNormalMap(const NormalMapBuffer &aMap, double alpha, bool onlyNormal,
+                bool fillFlat, bool bilinear, ColorImage &outputImage)
+{
+  const Z2i::Point lb = aMap.domain.lowerBound();
+  const Z2i::Point ub = aMap.domain.upperBound();
+  const int w = aMap.width;
+  const int h = aMap.height;
+  const double ca = cos(-alpha);
+  const double sa = sin(-alpha);
+  const float caf = static_cast<float>(ca);
+  const float saf = static_cast<float>(sa);
+  const Z2i::Point center (ub[0]/2, ub[1]/2);
+  auto itOut = outputImage.begin();
+
+#pragma omp parallel
+  {
+    std::vector<float> rowNx (w), rowNy (w), rowBlue (w);
+    std::vector<unsigned char> rowValid (w);
+#pragma omp for schedule(static)
+    for (int j = 0; j < h; j++){
+      const long long rowStart = static_cast<long long>(j)*w;
+      // sampling of the input map for the row j
+      if (onlyNormal){
+        for (int i = 0; i < w; i++){
+          rowNx[i] = aMap.nx[rowStart + i];
+          rowNy[i] = aMap.ny[rowStart + i];
+          rowBlue[i] = aMap.blue[rowStart + i];
+          rowValid[i] = 1;
+        }
+      }
+      else{
+        const double dy = ub[1] - (lb[1] + j) - center[1];
+        const double dx0 = lb[0] - center[0];
+        // positions of the row start, then incremented by (ca, sa) along the row
+        const double rx0 = dx0*ca - dy*sa;
+        const double ry0 = dy*ca + dx0*sa;
+        for (int i = 0; i < w; i++){
+          const double rx = rx0 + i*ca;
+          const double ry = ry0 + i*sa;
+          rowValid[i] = 0;
+          if (!bilinear){
+            const int qx = static_cast<int>(rx) + center[0] - lb[0];
+            const int qy = ub[1] - (static_cast<int>(ry) + center[1]) - lb[1];
+            if (qx >= 0 && qx < w && qy >= 0 && qy < h){
+              const long long k = static_cast<long long>(qy)*w + qx;
+              rowNx[i] = aMap.nx[k];
+              rowNy[i] = aMap.ny[k];
+              rowBlue[i] = aMap.blue[k];
+              rowValid[i] = 1;
+            }
+          }
+          else{
+            const double fx = rx + center[0] - lb[0];
+            const double fy = ub[1] - (ry + center[1]) - lb[1];
+            const int x0 = static_cast<int>(std::floor(fx));
+            const int y0 = static_cast<int>(std::floor(fy));
+            if (x0 >= 0 && x0 < w && y0 >= 0 && y0 < h){
+              const float tx = static_cast<float>(fx - x0);
+              const float ty = static_cast<float>(fy - y0);
+              const int x1 = std::min(x0 + 1, w - 1);
+              const int y1 = std::min(y0 + 1, h - 1);
+              const long long k00 = static_cast<long long>(y0)*w + x0;
+              const long long k10 = static_cast<long long>(y0)*w + x1;
+              const long long k01 = static_cast<long long>(y1)*w + x0;
+              const long long k11 = static_cast<long long>(y1)*w + x1;
+              const float w00 = (1.0f-tx)*(1.0f-ty), w10 = tx*(1.0f-ty);
+              const float w01 = (1.0f-tx)*ty, w11 = tx*ty;
+              rowNx[i] = w00*aMap.nx[k00] + w10*aMap.nx[k10] + w01*aMap.nx[k01] + w11*aMap.nx[k11];
+              rowNy[i] = w00*aMap.ny[k00] + w10*aMap.ny[k10] + w01*aMap.ny[k01] + w11*aMap.ny[k11];
+              rowBlue[i] = w00*aMap.blue[k00] + w10*aMap.blue[k10] + w01*aMap.blue[k01] + w11*aMap.blue[k11];
+              rowValid[i] = 1;
+            }
+          }
+        }
+      }
+      // rotation of the normals of the row
+      float *pnx = rowNx.data();
+      float *pny = rowNy.data();
+#pragma omp simd
+      for (int i = 0; i < w; i++){
+        const float x = pnx[i];
+        const float y = pny[i];
+        pnx[i] = x*caf - y*saf;
+        pny[i] = y*caf + x*saf;
+      }
+      for (int i = 0; i < w; i++){
+        if (rowValid[i]){
+          itOut[rowStart + i] = Color(encodeNormalComponent(rowNx[i]),
+                                      encodeNormalComponent(rowNy[i]),
+                                      static_cast<unsigned char>(std::min(255.0f, rowBlue[i] + 0.5f)));
+        }
+        else if (fillFlat){
+          itOut[rowStart + i] = Color(128, 128, 255);
+        }
+      }
+    }
+  }
+}
+
+
+/**
+ * @return the name of the kth output (name_k.ext).
+ */
+static
+std::string
+batchOutputName(const std::string &outputFileName, unsigned int k)
+{
+  std::size_t posExt = outputFileName.find_last_of(".");
+  std::stringstream res;
+  res << outputFileName.substr(0, posExt) << "_" << k;
+  if (posExt != std::string::npos){
+    res << outputFileName.substr(posExt);
+  }
+  return res.str();
+}
+
+
 int main( int argc, char** argv )
 {
     double alpha {3.14};
@@ -87,6 +282,8 @@ int main( int argc, char** argv )
     std::stringstream usage;
     bool onlyNormal {false};
     bool fillFlat {false};
+    bool bilinear {false};
+    std::vector<double> angles;
     
     usage << "Usage: " << argv[0] << " [input]\n"
     << "Typical use example:\n \t rotNmap normalMap.png normalRotated 1.5 \n";
@@ -95,16 +292,18 @@ int main( int argc, char** argv )
     app.description("Applies a rotation in the input normal map (it rotates both the position and normals orientation to be consistant. \n" + usage.str() );
     app.add_option("--input,-i,1", inputFileName, "Input file")->required()->check(CLI::ExistingFile);
     app.add_option("--output,-o,2", outputFileName, "Output SDP filename")->required();
-    app.add_option("--angle,-a, 3", alpha, "a double angle");
+    auto angleOpt = app.add_option("--angle,-a, 3", alpha, "a double angle");
     app.add_flag("--onlyNormal,-n", onlyNormal, "rotate only normal not the map itself");
     app.add_flag("--fillFlat,-f", fillFlat, "fill area with missing information by vertical normal (ie Color (128, 128, 255))");
+    app.add_flag("--bilinear,-b", bilinear, "use bilinear interpolation instead of nearest neighbor to sample the input map.");
+    app.add_option("--angles", angles, "apply several rotations from the same input: the result of the kth angle is exported in output_k.ext.")
+    ->excludes(angleOpt);
     
     app.get_formatter()->column_width(40);
     CLI11_PARSE(app, argc, argv);
     // END parse command line using CLI ----------------------------------------------
     
     // Some nice processing  --------------------------------------------------
-    typedef ImageContainerBySTLVector<Z2i::Domain, Color> ColorImage;
     
     
     trace.info() << "Starting " << argv[0]  << "with input: " <<  inputFileName
@@ -113,45 +312,27 @@ int main( int argc, char** argv )
     
     trace.info() << "Reading input image color:";
     ColorImage inputImage = STBReader<ColorImage>::import(inputFileName);
-    ColorImage outputImage (inputImage.domain());
     trace.info() << " [done] size:"
     <<  inputImage.domain().lowerBound()-inputImage.domain().upperBound()
     << std::endl;
-    // Rotating normals with angle:
-    for (auto p: outputImage.domain()){
-        Z2i::Point center (inputImage.domain().upperBound()[0]/2,
-                           inputImage.domain().upperBound()[1]/2);
-        Z2i::RealPoint n (0.0, 0.0);
-        Z2i::Point pr ((p[0]-center[0])*cos(-alpha)  - (inputImage.domain().upperBound()[1]-p[1]-center[1])*sin(-alpha),
-                       (inputImage.domain().upperBound()[1]-p[1]-center[1])*cos(-alpha)
-                       + (p[0]-center[0])*sin(-alpha));
-        pr[0] = pr[0]+center[0];
-        pr[1] = inputImage.domain().upperBound()[1]-(pr[1]+center[1]);
-        if (outputImage.domain().isInside(pr)|| onlyNormal){
-            n[0] = ((double)inputImage(onlyNormal ? p:pr).red()/255.0)*2.0-1.0;
-            n[1] = ((double)inputImage(onlyNormal ? p:pr).green()/255.0)*2.0-1.0;
-            double x = n[0];
-            double y = n[1];
-            n[0] = x*cos(-alpha) - y*sin(-alpha);
-            n[1] = y*cos(-alpha) + x*sin(-alpha);
-            if (onlyNormal){
-                Color c (static_cast<unsigned int>(std::min(255.0,(n[0]+1.0)*128.0)),
-                         static_cast<unsigned int>(std::min(255.0,(n[1]+1.0)*128.0)),
-                         inputImage(p).blue());
-                outputImage.setValue(p, c);
-            }
-            else{
-                Color c (static_cast<unsigned int>(std::min(255.0,(n[0]+1.0)*128.0)),
-                         static_cast<unsigned int>(std::min(255.0,(n[1]+1.0)*128.0)),
-                         inputImage(pr).blue());
-                outputImage.setValue(p, c);
-            }
-        }else if (fillFlat){
-            Color c (128, 128, 255);
-            outputImage.setValue(p, c);
+    NormalMapBuffer normalMap = unpackNormalMap(inputImage);
+
+    if (angles.size() == 0)
+    {
+        ColorImage outputImage (inputImage.domain());
+        rotateNormalMap(normalMap, alpha, onlyNormal, fillFlat, bilinear, outputImage);
+        outputImage >> outputFileName ;
+    }
+    else
+    {
+        trace.progressBar(0, angles.size());
+        for (unsigned int k = 0; k < angles.size(); k++)
+        {
+            ColorImage outputImage (inputImage.domain());
+            rotateNormalMap(normalMap, angles[k], onlyNormal, fillFlat, bilinear, outputImage);
+            outputImage >> batchOutputName(outputFileName, k);
+            trace.progressBar(k+1, angles.size());
         }
     }
-    
-    outputImage >> outputFileName ;
     return 0;
 }
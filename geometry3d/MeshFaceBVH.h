@@ -0,0 +1,496 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+/**
+ * @file MeshFaceBVH.h
+ * @ingroup geometry3d
+ *
+ * @date 2026/10/18
+ *
+ * Bounding volume hierarchy (axis aligned bounding boxes) on the faces
+ * of a mesh to compute exact point to mesh distances.
+ *
+ * This file is part of the DGtal library/DGtalTools-contrib Project.
+ */
+
+#ifndef MESH_FACE_BVH_H
+#define MESH_FACE_BVH_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "DGtal/base/Common.h"
+#include "DGtal/helpers/StdDefs.h"
+#include "DGtal/shapes/Mesh.h"
+
+#include "TriangleDistanceKernel.h"
+
+
+/**
+ * Location of the closest point on a triangle.
+ */
+enum TriangleRegion {TRIANGLE_INSIDE, TRIANGLE_EDGE, TRIANGLE_VERTEX};
+
+
+/**
+ * Computes the closest point of the triangle (a, b, c) to the point p
+ * (from C. Ericson, Real-Time Collision Detection, section 5.1.5).
+ *
+ * @param p the query point.
+ * @param a first vertex of the triangle.
+ * @param b second vertex of the triangle.
+ * @param c third vertex of the triangle.
+ * @param[out] region the location of the closest point (inside, on an edge or on a vertex).
+ * @return the closest point.
+ */
+template<typename TPoint>
+TPoint
+closestPointOnTriangle(const TPoint &p, const TPoint &a, const TPoint &b,
+                       const TPoint &c, TriangleRegion &region)
+{
+  const TPoint ab = b - a;
+  const TPoint ac = c - a;
+  const TPoint ap = p - a;
+  const double d1 = ab.dot(ap);
+  const double d2 = ac.dot(ap);
+  region = TRIANGLE_VERTEX;
+  if (d1 <= 0.0 && d2 <= 0.0) return a;
+
+  const TPoint bp = p - b;
+  const double d3 = ab.dot(bp);
+  const double d4 = ac.dot(bp);
+  if (d3 >= 0.0 && d4 <= d3) return b;
+
+  const double vc = d1*d4 - d3*d2;
+  region = TRIANGLE_EDGE;
+  if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0 && d1 - d3 > 0.0){
+    return a + ab*(d1/(d1 - d3));
+  }
+
+  const TPoint cp = p - c;
+  const double d5 = ab.dot(cp);
+  const double d6 = ac.dot(cp);
+  region = TRIANGLE_VERTEX;
+  if (d6 >= 0.0 && d5 <= d6) return c;
+
+  const double vb = d5*d2 - d1*d6;
+  region = TRIANGLE_EDGE;
+  if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0 && d2 - d6 > 0.0){
+    return a + ac*(d2/(d2 - d6));
+  }
+
+  const double va = d3*d6 - d5*d4;
+  if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0 && (d4 - d3) + (d5 - d6) > 0.0){
+    return b + (c - b)*((d4 - d3)/((d4 - d3) + (d5 - d6)));
+  }
+
+  const double sum = va + vb + vc;
+  if (sum <= 0.0){
+    // degenerated triangle: the closest point is on its longest edge.
+    const TPoint bc = c - b;
+    const double tab = std::max(0.0, std::min(1.0, ab.dot(ap)/std::max(ab.dot(ab), 1e-300)));
+    const double tac = std::max(0.0, std::min(1.0, ac.dot(ap)/std::max(ac.dot(ac), 1e-300)));
+    const double tbc = std::max(0.0, std::min(1.0, bc.dot(bp)/std::max(bc.dot(bc), 1e-300)));
+    const TPoint q1 = a + ab*tab;
+    const TPoint q2 = a + ac*tac;
+    const TPoint q3 = b + bc*tbc;
+    const double e1 = (p - q1).dot(p - q1);
+    const double e2 = (p - q2).dot(p - q2);
+    const double e3 = (p - q3).dot(p - q3);
+    return e1 <= e2 && e1 <= e3 ? q1 : (e2 <= e3 ? q2 : q3);
+  }
+  region = TRIANGLE_INSIDE;
+  const double denom = 1.0/sum;
+  const double v = vb*denom;
+  const double w = vc*denom;
+  return a + ab*v + ac*w;
+}
+
+
+
+/**
+ * Bounding volume hierarchy of the faces of a mesh. The faces are split
+ * into triangles (fan triangulation from their first vertex) which are
+ * stored in the leaves of a binary tree of axis aligned bounding boxes
+ * (built by median split on the largest axis). The closest point
+ * queries are exact and use a branch and bound traversal (the nearest
+ * child is visited first and the boxes farther than the current best
+ * distance are pruned). The triangles of each leaf are also stored by
+ * batches of batchWidth triangles (structure of arrays) to compute
+ * their distances to the query point with SIMD instructions.
+ */
+class MeshFaceBVH
+{
+public:
+  typedef DGtal::Z3i::RealPoint RealPoint;
+  typedef DGtal::Mesh<RealPoint> Mesh;
+  /// number of triangles processed together by the distance kernel.
+  static const unsigned int batchWidth = 8;
+  typedef TriangleBatch<double, batchWidth> Batch;
+  typedef TriangleBatchResult<double, batchWidth> BatchResult;
+
+  /**
+   * Result of a closest point query.
+   */
+  struct Result
+  {
+    double distance;
+    RealPoint nearest;
+    unsigned int face;
+    TriangleRegion region;
+  };
+
+  /**
+   * Builds the hierarchy.
+   *
+   * @param aMesh the mesh.
+   * @param aLeafSize the maximal number of triangles in a leaf.
+   */
+  MeshFaceBVH(const Mesh &aMesh, unsigned int aLeafSize = 8): myLeafSize(aLeafSize)
+  {
+    for (unsigned int f = 0; f < aMesh.nbFaces(); f++){
+      const Mesh::MeshFace &aFace = aMesh.getFace(f);
+      for (unsigned int k = 1; k + 1 < aFace.size(); k++){
+        myTriangles.push_back({aMesh.getVertex(aFace[0]), aMesh.getVertex(aFace[k]),
+                               aMesh.getVertex(aFace[k+1]), f});
+      }
+    }
+    if (myTriangles.size() != 0){
+      myNodes.reserve(2*myTriangles.size()/std::max(1u, myLeafSize) + 1);
+      build(0, static_cast<unsigned int>(myTriangles.size()));
+      buildBatches();
+      buildDipoles();
+    }
+  }
+
+  /**
+   * @return the number of triangles of the hierarchy.
+   */
+  std::size_t nbTriangles() const
+  {
+    return myTriangles.size();
+  }
+
+  /**
+   * @return the number of nodes of the hierarchy.
+   */
+  std::size_t nbNodes() const
+  {
+    return myNodes.size();
+  }
+
+  /**
+   * Computes the closest point of the mesh to a point.
+   *
+   * @param p the query point.
+   * @param aMaxDistance only the points closer than this distance are
+   * searched (if none, the result distance is infinite).
+   * @param aStopDistance the search stops as soon as a point at a
+   * distance lower or equal to aStopDistance is found (the result is
+   * then an upper bound of the distance which is not greater than
+   * aStopDistance). By default the search is exact.
+   * @return the closest point, its distance and its face.
+   */
+  Result closest(const RealPoint &p,
+                 double aMaxDistance = std::numeric_limits<double>::infinity(),
+                 double aStopDistance = -1.0) const
+  {
+    Result res {std::numeric_limits<double>::infinity(), p, 0, TRIANGLE_INSIDE};
+    if (myNodes.size() == 0) return res;
+    double bestSq = aMaxDistance == std::numeric_limits<double>::infinity() ?
+      aMaxDistance : aMaxDistance*aMaxDistance;
+    const double stopSq = aStopDistance < 0 ? -1.0 : aStopDistance*aStopDistance;
+    bool found = false;
+    BatchResult r;
+    unsigned int stack[64];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize != 0){
+      const Node &n = myNodes[stack[--stackSize]];
+      if (boxSquaredDistance(n, p) >= bestSq) continue;
+      if (n.count != 0){
+        for (unsigned int b = n.batch; b < n.batch + (n.count + batchWidth - 1)/batchWidth; b++){
+          const unsigned int first = n.start + (b - n.batch)*batchWidth;
+          const unsigned int nbLanes = std::min(batchWidth, n.start + n.count - first);
+          if (myIsDegenerated[b]){
+            for (unsigned int i = first; i < first + nbLanes; i++){
+              const Triangle &t = myTriangles[i];
+              TriangleRegion region;
+              RealPoint q = closestPointOnTriangle(p, t.a, t.b, t.c, region);
+              const double dSq = (q - p).dot(q - p);
+              if (dSq < bestSq){
+                found = true;
+                bestSq = dSq;
+                res.nearest = q;
+                res.face = t.face;
+                res.region = region;
+              }
+            }
+            continue;
+          }
+          closestPointsOnTriangles(myBatches[b], p[0], p[1], p[2], r);
+          for (unsigned int l = 0; l < nbLanes; l++){
+            if (r.squaredDistance[l] < bestSq){
+              const Triangle &t = myTriangles[first + l];
+              found = true;
+              bestSq = r.squaredDistance[l];
+              res.nearest = t.a + (t.b - t.a)*r.v[l] + (t.c - t.a)*r.w[l];
+              res.face = t.face;
+              res.region = static_cast<TriangleRegion>(r.region[l]);
+            }
+          }
+        }
+        if (bestSq <= stopSq) break;
+      }
+      else{
+        const double dl = boxSquaredDistance(myNodes[n.left], p);
+        const double dr = boxSquaredDistance(myNodes[n.right], p);
+        // the nearest child is pushed last to be visited first.
+        if (dl < dr){
+          if (dr < bestSq) stack[stackSize++] = n.right;
+          if (dl < bestSq) stack[stackSize++] = n.left;
+        }else{
+          if (dl < bestSq) stack[stackSize++] = n.left;
+          if (dr < bestSq) stack[stackSize++] = n.right;
+        }
+      }
+    }
+    if (found){
+      res.distance = std::sqrt(bestSq);
+    }
+    return res;
+  }
+
+  /**
+   * Computes the generalized winding number of the mesh at a point with
+   * the fast approximation of Barill et al. (Fast Winding Numbers for
+   * Soups and Clouds, 2018): the triangles of a node whose center is
+   * farther than aBeta times its radius are approximated by a dipole (sum
+   * of their area vectors at their area weighted center), the others are
+   * summed exactly from their solid angle. The cost is logarithmic in
+   * the number of triangles for the points which are not too close to
+   * the mesh.
+   *
+   * @param q the query point.
+   * @param aBeta the accuracy parameter (distance of the approximated
+   * nodes in number of node radius).
+   * @return the winding number (close to 1 inside a closed mesh with
+   * outward oriented faces and close to 0 outside).
+   */
+  double windingNumber(const RealPoint &q, double aBeta = 2.0) const
+  {
+    if (myNodes.size() == 0) return 0.0;
+    double w = 0.0;
+    unsigned int stack[64];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize != 0){
+      const unsigned int id = stack[--stackSize];
+      const Node &n = myNodes[id];
+      const Dipole &d = myDipoles[id];
+      const RealPoint v = d.center - q;
+      const double dist = v.norm();
+      if (dist > aBeta*d.radius){
+        w += d.normal.dot(v)/(dist*dist*dist);
+      }else if (n.count != 0){
+        for (unsigned int i = n.start; i < n.start + n.count; i++){
+          w += solidAngle(myTriangles[i], q);
+        }
+      }else{
+        stack[stackSize++] = n.left;
+        stack[stackSize++] = n.right;
+      }
+    }
+    return w/(4.0*M_PI);
+  }
+
+private:
+  struct Triangle
+  {
+    RealPoint a, b, c;
+    unsigned int face;
+  };
+
+  /// node of the tree: a leaf if count != 0 (triangles [start, start+count)
+  /// stored in the batches starting at batch).
+  struct Node
+  {
+    double lower[3];
+    double upper[3];
+    unsigned int start;
+    unsigned int count;
+    unsigned int left;
+    unsigned int right;
+    unsigned int batch;
+  };
+
+  static double boxSquaredDistance(const Node &n, const RealPoint &p)
+  {
+    double d = 0.0;
+    for (unsigned int k = 0; k < 3; k++){
+      const double v = p[k] < n.lower[k] ? n.lower[k] - p[k] :
+                       (p[k] > n.upper[k] ? p[k] - n.upper[k] : 0.0);
+      d += v*v;
+    }
+    return d;
+  }
+
+  unsigned int build(unsigned int aStart, unsigned int anEnd)
+  {
+    const unsigned int id = static_cast<unsigned int>(myNodes.size());
+    myNodes.push_back(Node());
+    Node n;
+    double cLower[3], cUpper[3];
+    for (unsigned int k = 0; k < 3; k++){
+      n.lower[k] = cLower[k] = std::numeric_limits<double>::max();
+      n.upper[k] = cUpper[k] = std::numeric_limits<double>::lowest();
+    }
+    for (unsigned int i = aStart; i < anEnd; i++){
+      const Triangle &t = myTriangles[i];
+      for (unsigned int k = 0; k < 3; k++){
+        n.lower[k] = std::min({n.lower[k], t.a[k], t.b[k], t.c[k]});
+        n.upper[k] = std::max({n.upper[k], t.a[k], t.b[k], t.c[k]});
+        const double c = (t.a[k] + t.b[k] + t.c[k])/3.0;
+        cLower[k] = std::min(cLower[k], c);
+        cUpper[k] = std::max(cUpper[k], c);
+      }
+    }
+    n.start = aStart;
+    n.count = anEnd - aStart;
+    n.left = n.right = n.batch = 0;
+    // the tree depth is bounded by the median split (stack of the queries).
+    if (n.count > myLeafSize){
+      unsigned int axis = 0;
+      for (unsigned int k = 1; k < 3; k++){
+        if (cUpper[k] - cLower[k] > cUpper[axis] - cLower[axis]) axis = k;
+      }
+      const unsigned int mid = aStart + (anEnd - aStart)/2;
+      std::nth_element(myTriangles.begin() + aStart, myTriangles.begin() + mid,
+                       myTriangles.begin() + anEnd,
+                       [axis](const Triangle &t1, const Triangle &t2){
+                         return t1.a[axis] + t1.b[axis] + t1.c[axis] <
+                                t2.a[axis] + t2.b[axis] + t2.c[axis];
+                       });
+      n.count = 0;
+      n.left = build(aStart, mid);
+      n.right = build(mid, anEnd);
+    }
+    myNodes[id] = n;
+    return id;
+  }
+
+  /**
+   * Copies the triangles of the leaves in batches (the lanes after the
+   * last triangle of a leaf repeat it). The batches containing a
+   * degenerated triangle are processed without the kernel.
+   */
+  void buildBatches()
+  {
+    for (Node &n: myNodes){
+      if (n.count == 0) continue;
+      n.batch = static_cast<unsigned int>(myBatches.size());
+      for (unsigned int first = n.start; first < n.start + n.count; first += batchWidth){
+        Batch batch;
+        bool degenerated = false;
+        for (unsigned int l = 0; l < batchWidth; l++){
+          const Triangle &t = myTriangles[std::min(first + l, n.start + n.count - 1)];
+          batch.set(l, t.a, t.b, t.c);
+          const RealPoint ab = t.b - t.a;
+          const RealPoint ac = t.c - t.a;
+          const RealPoint normal = ab.crossProduct(ac);
+          degenerated = degenerated || normal.dot(normal) <= 1e-12*ab.dot(ab)*ac.dot(ac);
+        }
+        myBatches.push_back(batch);
+        myIsDegenerated.push_back(degenerated);
+      }
+    }
+  }
+
+  /// first order approximation of the triangles of a node.
+  struct Dipole
+  {
+    RealPoint normal;
+    RealPoint center;
+    double area;
+    double radius;
+  };
+
+  /// solid angle of a triangle seen from a point (Van Oosterom and Strackee).
+  static double solidAngle(const Triangle &t, const RealPoint &q)
+  {
+    const RealPoint a = t.a - q;
+    const RealPoint b = t.b - q;
+    const RealPoint c = t.c - q;
+    const double la = a.norm(), lb = b.norm(), lc = c.norm();
+    const double num = a.dot(b.crossProduct(c));
+    const double den = la*lb*lc + a.dot(b)*lc + a.dot(c)*lb + b.dot(c)*la;
+    return 2.0*std::atan2(num, den);
+  }
+
+  /**
+   * Computes the dipoles of the nodes (the children of a node have
+   * greater indices than the node).
+   */
+  void buildDipoles()
+  {
+    myDipoles.resize(myNodes.size());
+    for (std::size_t id = myNodes.size(); id > 0; id--){
+      const Node &n = myNodes[id - 1];
+      Dipole &d = myDipoles[id - 1];
+      d.normal = RealPoint(0, 0, 0);
+      d.center = RealPoint(0, 0, 0);
+      d.area = 0.0;
+      d.radius = 0.0;
+      if (n.count != 0){
+        RealPoint centroids (0, 0, 0);
+        for (unsigned int i = n.start; i < n.start + n.count; i++){
+          const Triangle &t = myTriangles[i];
+          const RealPoint areaVector = (t.b - t.a).crossProduct(t.c - t.a)*0.5;
+          const double area = areaVector.norm();
+          const RealPoint centroid = (t.a + t.b + t.c)/3.0;
+          d.normal += areaVector;
+          d.center += centroid*area;
+          d.area += area;
+          centroids += centroid;
+        }
+        d.center = d.area > 0 ? d.center/d.area : centroids/static_cast<double>(n.count);
+        for (unsigned int i = n.start; i < n.start + n.count; i++){
+          const Triangle &t = myTriangles[i];
+          d.radius = std::max({d.radius, (t.a - d.center).norm(), (t.b - d.center).norm(),
+                               (t.c - d.center).norm()});
+        }
+      }else{
+        const Dipole &l = myDipoles[n.left];
+        const Dipole &r = myDipoles[n.right];
+        d.normal = l.normal + r.normal;
+        d.area = l.area + r.area;
+        d.center = d.area > 0 ? (l.center*l.area + r.center*r.area)/d.area : (l.center + r.center)/2.0;
+        d.radius = std::max((l.center - d.center).norm() + l.radius,
+                            (r.center - d.center).norm() + r.radius);
+      }
+    }
+  }
+
+  unsigned int myLeafSize;
+  std::vector<Triangle> myTriangles;
+  std::vector<Node> myNodes;
+  std::vector<Batch> myBatches;
+  std::vector<bool> myIsDegenerated;
+  std::vector<Dipole> myDipoles;
+};
+
+#endif // MESH_FACE_BVH_H
@@ -0,0 +1,280 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+/**
+ * @file PointSetWriter.h
+ * @ingroup geometry3d
+ *
+ * @date 2026/10/18
+ *
+ * Export of point sets (rows of the 3 coordinates of a point followed by
+ * optional values) shared by the tools which emit points: text (sdp/xyz),
+ * binary arrays (32 or 64 bit integers, or floats), NumPy arrays and a
+ * sparse format of voxels sorted and delta encoded.
+ *
+ * This file is part of the DGtal library/DGtalTools-contrib Project.
+ */
+
+#ifndef POINT_SET_WRITER_H
+#define POINT_SET_WRITER_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <numeric>
+#include <algorithm>
+#include <type_traits>
+#include <cstring>
+#include <limits>
+
+#include "DGtal/base/Common.h"
+#include "DGtal/helpers/StdDefs.h"
+
+
+/**
+ * Output formats of a point set:
+ * - text: one line per point with its coordinates and values (sdp, xyz),
+ *   after an optional comment line starting with #.
+ * - bin: rows of 32 bit integers (integer point sets) or floats in the
+ *   byte order of the host, without header (a binary xyz file when there
+ *   is no value). The integers are written on 64 bits when a value does
+ *   not fit in 32 bits (reported on the trace).
+ * - npy: the same array with a NumPy header (format version 1.0) giving
+ *   its type (<i4, <i8 or <f4) and shape.
+ * - sparse: voxels of a domain. A text header of three lines
+ *   "SPARSE_POINTS 1", "domain lx ly lz ux uy uz" and
+ *   "points n values k type" (type of the values as in NumPy, <i4, <i8 or
+ *   <f4), then the differences between the linear indices (x first) of
+ *   consecutive voxels sorted by index, as unsigned LEB128 varints (the
+ *   first one is the index of the first voxel), then the n rows of k
+ *   values.
+ */
+enum class PointSetFormat {TEXT, BINARY, NPY, SPARSE};
+
+
+/**
+ * @return the names of the formats (for the options of the tools).
+ */
+inline std::vector<std::string>
+pointSetFormatNames()
+{
+  return {"text", "bin", "npy", "sparse"};
+}
+
+
+/**
+ * @return the format of a name of pointSetFormatNames().
+ */
+inline PointSetFormat
+pointSetFormat(const std::string &aName)
+{
+  return aName == "bin" ? PointSetFormat::BINARY :
+         aName == "npy" ? PointSetFormat::NPY :
+         aName == "sparse" ? PointSetFormat::SPARSE : PointSetFormat::TEXT;
+}
+
+
+/**
+ * @return true if the host stores the values in little endian.
+ */
+inline bool
+isLittleEndian()
+{
+  const DGtal::uint16_t one = 1;
+  unsigned char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+
+/**
+ * Writes the NumPy header (format version 1.0) of a C order array.
+ *
+ * @param out the binary output stream.
+ * @param aType the type of the values without the byte order (f4, i4, i8).
+ * @param nbRows the number of rows of the array.
+ * @param nbColumns the number of columns of the array.
+ */
+inline void
+writeNpyHeader(std::ostream &out, const std::string &aType, std::size_t nbRows, std::size_t nbColumns)
+{
+  std::stringstream header;
+  header << "{'descr': '" << (isLittleEndian() ? "<" : ">") << aType << "', 'fortran_order': False, 'shape': ("
+         << nbRows << ", " << nbColumns << "), }";
+  std::string dict = header.str();
+  // the magic string, the version and the header length take 10 bytes,
+  // the data starts on a multiple of 64 bytes.
+  const std::size_t headerSize = ((10 + dict.size() + 1 + 63)/64)*64 - 10;
+  dict.append(headerSize - dict.size() - 1, ' ');
+  dict.push_back('\n');
+  const unsigned char prefix[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                                    static_cast<unsigned char>(headerSize & 0xFF),
+                                    static_cast<unsigned char>(headerSize >> 8)};
+  out.write(reinterpret_cast<const char*>(prefix), 10);
+  out.write(dict.data(), dict.size());
+}
+
+
+/**
+ * @return true if the integer values of the columns from aFirstColumn of
+ * the rows fit in 32 bits (always true for reals).
+ */
+template<typename TScalar>
+bool
+fitsIn32Bits(const std::vector<TScalar> &rows, unsigned int nbColumns, unsigned int aFirstColumn)
+{
+  if constexpr (std::is_integral<TScalar>::value && sizeof(TScalar) >= sizeof(DGtal::int32_t)){
+    const DGtal::int64_t minValue = std::numeric_limits<DGtal::int32_t>::min();
+    const DGtal::int64_t maxValue = std::numeric_limits<DGtal::int32_t>::max();
+    for (std::size_t r = 0; r < rows.size(); r += nbColumns){
+      for (unsigned int c = aFirstColumn; c < nbColumns; c++){
+        const TScalar v = rows[r + c];
+        if (v > static_cast<TScalar>(maxValue) || (std::is_signed<TScalar>::value && static_cast<DGtal::int64_t>(v) < minValue)){
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+
+/**
+ * Writes the columns from aFirstColumn of the rows converted to TBinary.
+ *
+ * @param out the binary output stream.
+ * @param rows the rows of nbColumns values.
+ * @param nbColumns the number of columns.
+ * @param aFirstColumn the first written column.
+ * @param anOrder the order of the written rows (nullptr: order of the rows).
+ */
+template<typename TBinary, typename TScalar>
+void
+writeBinaryRows(std::ostream &out, const std::vector<TScalar> &rows, unsigned int nbColumns,
+                unsigned int aFirstColumn, const std::vector<std::size_t> *anOrder)
+{
+  const std::size_t nbRows = rows.size()/nbColumns;
+  std::vector<TBinary> values;
+  values.reserve(nbRows*(nbColumns - aFirstColumn));
+  for (std::size_t k = 0; k < nbRows; k++){
+    const std::size_t i = anOrder == nullptr ? k : (*anOrder)[k];
+    for (unsigned int c = aFirstColumn; c < nbColumns; c++){
+      values.push_back(static_cast<TBinary>(rows[i*nbColumns + c]));
+    }
+  }
+  out.write(reinterpret_cast<const char*>(values.data()), values.size()*sizeof(TBinary));
+}
+
+
+/**
+ * Exports a point set.
+ *
+ * @param aFileName the output file.
+ * @param aFormat the format of the file.
+ * @param rows the rows of nbColumns values: the coordinates of a point
+ * followed by its values (integers or reals, written as 32 bit integers or
+ * floats in the binary formats, or as 64 bit integers when an integer
+ * does not fit in 32 bits).
+ * @param nbColumns the number of columns (at least 3).
+ * @param aComment the comment of the text format (without #, no comment
+ * line if empty).
+ * @param aDomain the domain of the voxels, required by the sparse format
+ * (without domain the point set is exported in the text format).
+ * @return true if the file was written.
+ */
+template<typename TScalar>
+bool
+exportPointSet(const std::string &aFileName, PointSetFormat aFormat,
+               const std::vector<TScalar> &rows, unsigned int nbColumns,
+               const std::string &aComment, const DGtal::Z3i::Domain *aDomain = nullptr)
+{
+  const std::size_t nbRows = rows.size()/nbColumns;
+  if (aFormat == PointSetFormat::SPARSE && aDomain == nullptr){
+    DGtal::trace.warning() << "the sparse format needs voxels, points exported in text." << std::endl;
+    aFormat = PointSetFormat::TEXT;
+  }
+  if (aFormat == PointSetFormat::TEXT){
+    std::ofstream out (aFileName.c_str());
+    if (!aComment.empty()){
+      out << "# " << aComment << "\n";
+    }
+    for (std::size_t i = 0; i < nbRows; i++){
+      for (unsigned int c = 0; c < nbColumns; c++){
+        out << (c == 0 ? "" : " ") << rows[i*nbColumns + c];
+      }
+      out << "\n";
+    }
+    return out.good();
+  }
+  // the coordinates of the sparse format are not written as values.
+  const unsigned int firstColumn = aFormat == PointSetFormat::SPARSE ? 3 : 0;
+  const bool wide = !fitsIn32Bits(rows, nbColumns, firstColumn);
+  const std::string binaryType = !std::is_integral<TScalar>::value ? "f4" : wide ? "i8" : "i4";
+  if (wide && aFormat == PointSetFormat::BINARY){
+    DGtal::trace.info() << "values exceeding 32 bits: " << aFileName << " contains 64 bit integers." << std::endl;
+  }
+  std::ofstream out (aFileName.c_str(), std::ofstream::out | std::ofstream::binary);
+  std::vector<std::size_t> order;
+  if (aFormat == PointSetFormat::SPARSE){
+    const DGtal::Z3i::Point lower = aDomain->lowerBound();
+    const DGtal::Z3i::Point upper = aDomain->upperBound();
+    const std::size_t nx = upper[0] - lower[0] + 1;
+    const std::size_t ny = upper[1] - lower[1] + 1;
+    std::vector<std::size_t> indices (nbRows);
+    for (std::size_t i = 0; i < nbRows; i++){
+      const TScalar *row = &rows[i*nbColumns];
+      indices[i] = (static_cast<std::size_t>(row[0] - lower[0]) +
+                    nx*(static_cast<std::size_t>(row[1] - lower[1]) +
+                        ny*static_cast<std::size_t>(row[2] - lower[2])));
+    }
+    order.resize(nbRows);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&indices](std::size_t a, std::size_t b){
+      return indices[a] < indices[b];
+    });
+    out << "SPARSE_POINTS 1\n"
+        << "domain " << lower[0] << " " << lower[1] << " " << lower[2] << " "
+        << upper[0] << " " << upper[1] << " " << upper[2] << "\n"
+        << "points " << nbRows << " values " << nbColumns - 3 << " "
+        << (isLittleEndian() ? "<" : ">") << binaryType << "\n";
+    std::vector<unsigned char> deltas;
+    deltas.reserve(nbRows*2);
+    std::size_t previous = 0;
+    for (const auto i: order){
+      std::size_t delta = indices[i] - previous;
+      previous = indices[i];
+      while (delta >= 0x80){
+        deltas.push_back(static_cast<unsigned char>((delta & 0x7F) | 0x80));
+        delta >>= 7;
+      }
+      deltas.push_back(static_cast<unsigned char>(delta));
+    }
+    out.write(reinterpret_cast<const char*>(deltas.data()), deltas.size());
+  }else if (aFormat == PointSetFormat::NPY){
+    writeNpyHeader(out, binaryType, nbRows, nbColumns);
+  }
+  const std::vector<std::size_t> *rowOrder = order.empty() ? nullptr : &order;
+  if (!std::is_integral<TScalar>::value){
+    writeBinaryRows<float>(out, rows, nbColumns, firstColumn, rowOrder);
+  }else if (wide){
+    writeBinaryRows<DGtal::int64_t>(out, rows, nbColumns, firstColumn, rowOrder);
+  }else{
+    writeBinaryRows<DGtal::int32_t>(out, rows, nbColumns, firstColumn, rowOrder);
+  }
+  return out.good();
+}
+
+#endif // POINT_SET_WRITER_H
@@ -0,0 +1,227 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+/**
+ * @file QuantileSketch.h
+ * @ingroup geometry3d
+ *
+ * @date 2026/10/18
+ *
+ * Streaming quantile estimation with bounded memory and distance
+ * statistics (mean, RMS, maximum) of a set of values.
+ *
+ * This file is part of the DGtal library/DGtalTools-contrib Project.
+ */
+
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+
+/**
+ * Streaming quantile sketch with relative accuracy (logarithmic buckets
+ * as in the DDSketch of Masson et al.). A value v is counted in the
+ * bucket ceil(log_gamma(|v|)) with gamma = (1+a)/(1-a), so that any
+ * returned quantile is within a relative error a of an exact value of
+ * the set. The memory does not depend on the number of values (the
+ * number of buckets is bounded, the smallest buckets are collapsed if
+ * needed) and two sketches with the same accuracy can be merged (to
+ * combine the sketches of several threads).
+ */
+class QuantileSketch
+{
+public:
+  /**
+   * Constructor.
+   *
+   * @param aRelativeAccuracy the relative accuracy of the quantiles.
+   * @param aMaxNbBuckets the maximal number of buckets for the positive
+   * (and for the negative) values.
+   */
+  QuantileSketch(double aRelativeAccuracy = 0.005, unsigned int aMaxNbBuckets = 2048):
+    myGamma((1.0 + aRelativeAccuracy)/(1.0 - aRelativeAccuracy)),
+    myLogGamma(std::log(myGamma)), myMaxNbBuckets(aMaxNbBuckets),
+    myNbZeros(0)
+  {}
+
+  /**
+   * Adds a value.
+   */
+  void add(double aValue)
+  {
+    if (std::abs(aValue) < minIndexableValue){
+      myNbZeros++;
+    }else if (aValue > 0){
+      myPositives.add(index(aValue), 1, myMaxNbBuckets);
+    }else{
+      myNegatives.add(index(-aValue), 1, myMaxNbBuckets);
+    }
+  }
+
+  /**
+   * Adds the values of another sketch (of the same accuracy).
+   */
+  void merge(const QuantileSketch &other)
+  {
+    myNbZeros += other.myNbZeros;
+    myPositives.merge(other.myPositives, myMaxNbBuckets);
+    myNegatives.merge(other.myNegatives, myMaxNbBuckets);
+  }
+
+  /**
+   * @return the number of values.
+   */
+  unsigned long long count() const
+  {
+    return myNbZeros + myPositives.count + myNegatives.count;
+  }
+
+  /**
+   * @param q a quantile in [0, 1] (0.5 for the median).
+   * @return the estimated quantile (0 if the sketch is empty).
+   */
+  double quantile(double q) const
+  {
+    const unsigned long long n = count();
+    if (n == 0) return 0.0;
+    q = std::max(0.0, std::min(1.0, q));
+    const unsigned long long rank = static_cast<unsigned long long>(q*(n - 1));
+    unsigned long long cumul = 0;
+    for (std::size_t i = myNegatives.bins.size(); i > 0; i--){
+      cumul += myNegatives.bins[i - 1];
+      if (cumul > rank) return -value(myNegatives.minIndex + static_cast<int>(i) - 1);
+    }
+    cumul += myNbZeros;
+    if (cumul > rank) return 0.0;
+    for (std::size_t i = 0; i < myPositives.bins.size(); i++){
+      cumul += myPositives.bins[i];
+      if (cumul > rank) return value(myPositives.minIndex + static_cast<int>(i));
+    }
+    return value(myPositives.minIndex + static_cast<int>(myPositives.bins.size()) - 1);
+  }
+
+private:
+  static constexpr double minIndexableValue = 1e-300;
+
+  /// buckets [minIndex, minIndex + bins.size()) of the positive or negative values.
+  struct Store
+  {
+    int minIndex {0};
+    std::vector<unsigned long long> bins;
+    unsigned long long count {0};
+
+    void add(int anIndex, unsigned long long aCount, unsigned int aMaxNbBuckets)
+    {
+      count += aCount;
+      if (bins.empty()){
+        minIndex = anIndex;
+        bins.assign(1, aCount);
+        return;
+      }
+      if (anIndex < minIndex){
+        bins.insert(bins.begin(), static_cast<std::size_t>(minIndex - anIndex), 0);
+        minIndex = anIndex;
+      }else if (anIndex >= minIndex + static_cast<int>(bins.size())){
+        bins.resize(static_cast<std::size_t>(anIndex - minIndex) + 1, 0);
+      }
+      bins[anIndex - minIndex] += aCount;
+      if (bins.size() > aMaxNbBuckets){
+        // the lowest buckets are collapsed in the first kept one.
+        const std::size_t nbRemoved = bins.size() - aMaxNbBuckets;
+        unsigned long long removed = 0;
+        for (std::size_t i = 0; i < nbRemoved; i++) removed += bins[i];
+        bins.erase(bins.begin(), bins.begin() + nbRemoved);
+        bins[0] += removed;
+        minIndex += static_cast<int>(nbRemoved);
+      }
+    }
+
+    void merge(const Store &other, unsigned int aMaxNbBuckets)
+    {
+      for (std::size_t i = 0; i < other.bins.size(); i++){
+        if (other.bins[i] != 0){
+          add(other.minIndex + static_cast<int>(i), other.bins[i], aMaxNbBuckets);
+        }
+      }
+    }
+  };
+
+  int index(double aPositiveValue) const
+  {
+    return static_cast<int>(std::ceil(std::log(aPositiveValue)/myLogGamma));
+  }
+
+  double value(int anIndex) const
+  {
+    return 2.0*std::exp(anIndex*myLogGamma)/(myGamma + 1.0);
+  }
+
+  double myGamma;
+  double myLogGamma;
+  unsigned int myMaxNbBuckets;
+  unsigned long long myNbZeros;
+  Store myPositives;
+  Store myNegatives;
+};
+
+
+
+/**
+ * Statistics of a set of distances: maximum, mean, RMS and quantiles
+ * (from a QuantileSketch).
+ */
+struct DistanceStatistics
+{
+  double maximum {0.0};
+  double sum {0.0};
+  double sumSquares {0.0};
+  unsigned long long count {0};
+  QuantileSketch sketch;
+
+  void add(double aDistance)
+  {
+    maximum = count == 0 ? aDistance : std::max(maximum, aDistance);
+    sum += aDistance;
+    sumSquares += aDistance*aDistance;
+    count++;
+    sketch.add(aDistance);
+  }
+
+  void merge(const DistanceStatistics &other)
+  {
+    if (other.count == 0) return;
+    maximum = count == 0 ? other.maximum : std::max(maximum, other.maximum);
+    sum += other.sum;
+    sumSquares += other.sumSquares;
+    count += other.count;
+    sketch.merge(other.sketch);
+  }
+
+  double mean() const
+  {
+    return count == 0 ? 0.0 : sum/count;
+  }
+
+  double rms() const
+  {
+    return count == 0 ? 0.0 : std::sqrt(sumSquares/count);
+  }
+};
+
+#endif // QUANTILE_SKETCH_H
@@ -0,0 +1,468 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+/**
+ * @file StructuringElement3D.h
+ * @ingroup geometry3d
+ *
+ * @date 2026/10/18
+ *
+ * Structuring element of a 3D volume (ball, cube, cross or any set of
+ * offsets) stored once as runs of offsets along x, and neighborhood
+ * reductions (min, max) over it of a volume with a margin (PaddedVolume)
+ * or of an ImageContainerBySTLVector.
+ *
+ * This file is part of the DGtal library/DGtalTools-contrib Project.
+ */
+
+#ifndef STRUCTURING_ELEMENT_3D_H
+#define STRUCTURING_ELEMENT_3D_H
+
+#include <vector>
+#include <array>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "DGtal/base/Common.h"
+#include "DGtal/helpers/StdDefs.h"
+#include "DGtal/io/readers/PointListReader.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/**
+ * Volume of the domain of an image with a margin on each side, stored in
+ * a single buffer (x first). A chain of operations is applied on such
+ * volumes (two of them are swapped when a filter needs a separate
+ * output), so that the margin removes the tests at the border of the
+ * domain and no image is allocated or copied between the operations.
+ */
+template<typename TValue>
+struct PaddedVolume
+{
+  std::array<int, 3> size;
+  std::array<int, 3> pad;
+  std::array<int, 3> dims;
+  std::vector<TValue> values;
+
+  PaddedVolume(const std::array<int, 3> &aSize, const std::array<int, 3> &aPad):
+    size(aSize), pad(aPad)
+  {
+    for (unsigned int a = 0; a < 3; a++){
+      dims[a] = size[a] + 2*pad[a];
+    }
+    values.resize(static_cast<std::size_t>(dims[0])*dims[1]*dims[2]);
+  }
+
+  /**
+   * @return the index of the voxel (x, y, z) of the domain (the voxels of
+   * the margin have coordinates in [-pad, 0) and [size, size + pad)).
+   */
+  std::size_t index(int x, int y, int z) const
+  {
+    return (x + pad[0]) + static_cast<std::size_t>(dims[0])*((y + pad[1]) +
+                                                             static_cast<std::size_t>(dims[1])*(z + pad[2]));
+  }
+
+  /**
+   * Sets the voxels of the margin to a value (the neutral value of the
+   * next filter).
+   */
+  void fillPadding(TValue aValue)
+  {
+#pragma omp parallel for schedule(static)
+    for (int z = 0; z < dims[2]; z++){
+      for (int y = 0; y < dims[1]; y++){
+        const auto row = values.begin() + static_cast<std::size_t>(dims[0])*(y + static_cast<std::size_t>(dims[1])*z);
+        if (z < pad[2] || z >= pad[2] + size[2] || y < pad[1] || y >= pad[1] + size[1]){
+          std::fill(row, row + dims[0], aValue);
+        }else{
+          std::fill(row, row + pad[0], aValue);
+          std::fill(row + pad[0] + size[0], row + dims[0], aValue);
+        }
+      }
+    }
+  }
+
+  template<typename TImage>
+  void importImage(const TImage &anImage)
+  {
+    const auto first = anImage.begin();
+#pragma omp parallel for schedule(static)
+    for (int z = 0; z < size[2]; z++){
+      for (int y = 0; y < size[1]; y++){
+        const auto row = first + static_cast<std::size_t>(size[0])*(y + static_cast<std::size_t>(size[1])*z);
+        std::copy(row, row + size[0], values.begin() + index(0, y, z));
+      }
+    }
+  }
+
+  template<typename TImage>
+  void exportImage(TImage &anImage) const
+  {
+    const auto first = anImage.begin();
+#pragma omp parallel for schedule(static)
+    for (int z = 0; z < size[2]; z++){
+      for (int y = 0; y < size[1]; y++){
+        const auto row = values.begin() + index(0, y, z);
+        std::copy(row, row + size[0], first + static_cast<std::size_t>(size[0])*(y + static_cast<std::size_t>(size[1])*z));
+      }
+    }
+  }
+};
+
+
+/**
+ * Set of offsets of a 3D structuring element. The offsets are sorted
+ * (z, then y, then x) and grouped in runs of consecutive x offsets, so
+ * that the reductions over the element process contiguous x-runs of the
+ * image buffer.
+ */
+class StructuringElement3D
+{
+public:
+  typedef DGtal::Z3i::Point Point;
+
+  /**
+   * Offsets (x, dy, dz) with xBegin <= x <= xEnd.
+   */
+  struct Run
+  {
+    int dy;
+    int dz;
+    int xBegin;
+    int xEnd;
+  };
+
+  /**
+   * Constructor.
+   *
+   * @param someOffsets the offsets of the element (duplicates are removed).
+   */
+  StructuringElement3D(std::vector<Point> someOffsets = std::vector<Point>())
+  {
+    std::sort(someOffsets.begin(), someOffsets.end(), [](const Point &a, const Point &b){
+      return a[2] != b[2] ? a[2] < b[2] : (a[1] != b[1] ? a[1] < b[1] : a[0] < b[0]);
+    });
+    someOffsets.erase(std::unique(someOffsets.begin(), someOffsets.end()), someOffsets.end());
+    myOffsets = someOffsets;
+    myLowerBound = Point(0, 0, 0);
+    myUpperBound = Point(0, 0, 0);
+    for (std::size_t i = 0; i < myOffsets.size(); i++){
+      const Point &o = myOffsets[i];
+      if (i == 0){
+        myLowerBound = o;
+        myUpperBound = o;
+      }
+      for (unsigned int k = 0; k < 3; k++){
+        myLowerBound[k] = std::min(myLowerBound[k], o[k]);
+        myUpperBound[k] = std::max(myUpperBound[k], o[k]);
+      }
+      if (!myRuns.empty() && myRuns.back().dy == o[1] && myRuns.back().dz == o[2] &&
+          myRuns.back().xEnd + 1 == o[0]){
+        myRuns.back().xEnd++;
+      }else{
+        myRuns.push_back({o[1], o[2], o[0], o[0]});
+      }
+    }
+  }
+
+  /**
+   * @param aRadius the radius of the ball.
+   * @param isClosed if true the ball |p| <= aRadius, otherwise |p| < aRadius.
+   * @return the ball centered at the origin.
+   */
+  static StructuringElement3D
+  ball(double aRadius, bool isClosed = false)
+  {
+    std::vector<Point> offsets;
+    const int r = static_cast<int>(std::ceil(aRadius));
+    const double r2 = aRadius*aRadius;
+    for (int z = -r; z <= r; z++){
+      for (int y = -r; y <= r; y++){
+        for (int x = -r; x <= r; x++){
+          const double d2 = x*x + y*y + z*z;
+          if (d2 < r2 || (isClosed && d2 == r2)){
+            offsets.push_back(Point(x, y, z));
+          }
+        }
+      }
+    }
+    return StructuringElement3D(offsets);
+  }
+
+  /**
+   * @return the cube [-aHalfSize, aHalfSize]^3.
+   */
+  static StructuringElement3D
+  cube(unsigned int aHalfSize)
+  {
+    std::vector<Point> offsets;
+    const int r = static_cast<int>(aHalfSize);
+    for (int z = -r; z <= r; z++){
+      for (int y = -r; y <= r; y++){
+        for (int x = -r; x <= r; x++){
+          offsets.push_back(Point(x, y, z));
+        }
+      }
+    }
+    return StructuringElement3D(offsets);
+  }
+
+  /**
+   * @return the cross made of the three axis segments [-aHalfSize, aHalfSize].
+   */
+  static StructuringElement3D
+  cross(unsigned int aHalfSize)
+  {
+    std::vector<Point> offsets;
+    const int r = static_cast<int>(aHalfSize);
+    for (int k = -r; k <= r; k++){
+      offsets.push_back(Point(k, 0, 0));
+      offsets.push_back(Point(0, k, 0));
+      offsets.push_back(Point(0, 0, k));
+    }
+    return StructuringElement3D(offsets);
+  }
+
+  /**
+   * @param aFileName a text file with one offset "x y z" per line (lines
+   * starting with # are ignored).
+   * @return the element of the offsets of the file.
+   */
+  static StructuringElement3D
+  fromFile(const std::string &aFileName)
+  {
+    return StructuringElement3D(DGtal::PointListReader<Point>::getPointsFromFile(aFileName));
+  }
+
+  /**
+   * @return the same element without the origin.
+   */
+  StructuringElement3D
+  withoutCenter() const
+  {
+    std::vector<Point> offsets;
+    for (const auto &o: myOffsets){
+      if (o != Point(0, 0, 0)) offsets.push_back(o);
+    }
+    return StructuringElement3D(offsets);
+  }
+
+  const std::vector<Point> & offsets() const
+  {
+    return myOffsets;
+  }
+
+  const std::vector<Run> & runs() const
+  {
+    return myRuns;
+  }
+
+  /**
+   * @return the lower corner of the bounding box of the offsets.
+   */
+  const Point & lowerBound() const
+  {
+    return myLowerBound;
+  }
+
+  /**
+   * @return the upper corner of the bounding box of the offsets.
+   */
+  const Point & upperBound() const
+  {
+    return myUpperBound;
+  }
+
+  std::size_t size() const
+  {
+    return myOffsets.size();
+  }
+
+  /**
+   * Reduces the values of the element around each voxel of a volume:
+   * the result at p is op(...op(op(neutral, I(p+o1)), I(p+o2))...) over
+   * the offsets o with p+o inside the domain (min for an erosion, max for
+   * a dilation).
+   *
+   * A run of L offsets (x, dy, dz) with xBegin <= x <= xEnd reduces, for
+   * each voxel, a window of L consecutive voxels of the row (y+dy, z+dz).
+   * The windows of each row of the volume are computed once for all the
+   * distinct lengths L of the runs with the algorithm of van Herk and
+   * Gil-Werman (3 operations per voxel whatever L), so that each run costs
+   * one operation per voxel: O(#runs + #lengths) per voxel instead of
+   * O(size), that is O(r^2) instead of O(r^3) for a ball of radius r. The
+   * margin of the rows is set to the neutral value so that the border of
+   * the domain needs no test (the loops on x are vectorized).
+   *
+   * The volume is cut in tiles of rows along y and slabs along z which are
+   * processed in parallel. The thread of a tile keeps the windows of the
+   * source rows of its current slice (the rows of the tile and the y extent
+   * of the element, for the z extent of the element), so that a source
+   * slice is processed once per slab. The height of the tiles bounds this
+   * memory by windowBudget bytes per thread (or by the windows of twice the
+   * y extent of the element, so that at most half of the source rows are
+   * processed twice).
+   *
+   * @param volume the input volume, with a margin along x at least the
+   * extent of the element along x (its margin is modified).
+   * @param[out] result the reduced volume (same size and margin, its
+   * margin is not modified).
+   * @param neutral the neutral value of op (and the value of the voxels
+   * without any offset inside the domain).
+   * @param op a commutative and associative operator (min or max).
+   */
+  template<typename TValue, typename TOperator>
+  void
+  reduce(PaddedVolume<TValue> &volume, PaddedVolume<TValue> &result, TValue neutral, const TOperator &op) const
+  {
+    const int nx = volume.size[0];
+    const int ny = volume.size[1];
+    const int nz = volume.size[2];
+    volume.fillPadding(neutral);
+    // distinct lengths of the runs.
+    std::vector<int> lengths;
+    for (const auto &run: myRuns){
+      lengths.push_back(run.xEnd - run.xBegin + 1);
+    }
+    std::sort(lengths.begin(), lengths.end());
+    lengths.erase(std::unique(lengths.begin(), lengths.end()), lengths.end());
+    std::vector<std::size_t> runLength (myRuns.size());
+    for (std::size_t i = 0; i < myRuns.size(); i++){
+      runLength[i] = std::lower_bound(lengths.begin(), lengths.end(),
+                                      myRuns[i].xEnd - myRuns[i].xBegin + 1) - lengths.begin();
+    }
+    const int pad = volume.pad[0];
+    const std::size_t width = volume.dims[0];
+    const std::size_t rowSize = width*lengths.size();
+    const int depth = myUpperBound[2] - myLowerBound[2] + 1;
+    const int extentY = myUpperBound[1] - myLowerBound[1];
+    // height of the tiles and number of slabs.
+    const std::size_t rowMemory = std::max<std::size_t>(1, rowSize*depth*sizeof(TValue));
+    const int budgetRows = static_cast<int>(std::min<std::size_t>(windowBudget/rowMemory, ny + extentY));
+    const int tileHeight = std::max(1, std::min(ny, std::max(budgetRows - extentY, extentY + 1)));
+    const int nbTiles = (ny + tileHeight - 1)/tileHeight;
+    const std::size_t tileRows = static_cast<std::size_t>(tileHeight) + extentY;
+    int nbThreads = 1;
+#ifdef _OPENMP
+    nbThreads = omp_get_max_threads();
+#endif
+    const int nbSlabs = std::max(1, std::min(nz, (nbThreads + nbTiles - 1)/nbTiles));
+#pragma omp parallel
+    {
+      // windows[slot][row][length][j]: reduction of the padded row on [j, j+L-1]
+      // for the source slices z' stored in the slots z' % depth and the source
+      // rows y' of the tile stored in the rows y' - (y0 + lower y offset).
+      std::vector<TValue> windows (rowSize*tileRows*depth);
+      std::vector<int> slotSlice (depth);
+      std::vector<TValue> g (width), h (width);
+#pragma omp for schedule(dynamic, 1)
+      for (int task = 0; task < nbTiles*nbSlabs; task++){
+        const int y0 = (task % nbTiles)*tileHeight;
+        const int y1 = std::min(ny, y0 + tileHeight);
+        const int z0 = static_cast<int>(static_cast<long>(task / nbTiles)*nz/nbSlabs);
+        const int z1 = static_cast<int>(static_cast<long>(task / nbTiles + 1)*nz/nbSlabs);
+        const int ys0 = std::max(0, y0 + myLowerBound[1]);
+        const int ys1 = std::min(ny, y1 + myUpperBound[1]);
+        std::fill(slotSlice.begin(), slotSlice.end(), -1);
+        for (int z = z0; z < z1; z++){
+          for (int dz = myLowerBound[2]; dz <= myUpperBound[2]; dz++){
+            const int zs = z + dz;
+            if (zs < 0 || zs >= nz || slotSlice[zs % depth] == zs) continue;
+            slotSlice[zs % depth] = zs;
+            TValue *slice = windows.data() + rowSize*tileRows*(zs % depth);
+            for (int ys = ys0; ys < ys1; ys++){
+              const TValue *row = volume.values.data() + volume.index(-pad, ys, zs);
+              for (std::size_t l = 0; l < lengths.size(); l++){
+                const std::size_t L = lengths[l];
+                TValue *w = slice + rowSize*(ys - y0 - myLowerBound[1]) + width*l;
+                if (L == 1){
+                  std::copy(row, row + width, w);
+                  continue;
+                }
+                for (std::size_t j = 0; j < width; j++){
+                  g[j] = (j % L == 0) ? row[j] : op(g[j - 1], row[j]);
+                }
+                for (std::size_t j = width; j-- > 0;){
+                  h[j] = (j % L == L - 1 || j == width - 1) ? row[j] : op(h[j + 1], row[j]);
+                }
+                for (std::size_t j = 0; j + L <= width; j++){
+                  w[j] = op(h[j], g[j + L - 1]);
+                }
+              }
+            }
+          }
+          for (int y = y0; y < y1; y++){
+            TValue *rowDst = result.values.data() + result.index(0, y, z);
+            std::fill(rowDst, rowDst + nx, neutral);
+            for (std::size_t i = 0; i < myRuns.size(); i++){
+              const Run &run = myRuns[i];
+              const int zs = z + run.dz;
+              if (y + run.dy < 0 || y + run.dy >= ny || zs < 0 || zs >= nz) continue;
+              const TValue *w = windows.data() + rowSize*(tileRows*(zs % depth) + (y + run.dy - y0 - myLowerBound[1])) +
+                                width*runLength[i] + pad + run.xBegin;
+#pragma omp simd
+              for (int x = 0; x < nx; x++){
+                rowDst[x] = op(rowDst[x], w[x]);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Reduces the values of the element around each voxel of an image (see
+   * the reduction of a PaddedVolume).
+   *
+   * @param anImage an image (ImageContainerBySTLVector).
+   * @param neutral the neutral value of op.
+   * @param op a commutative and associative operator (min or max).
+   * @return the reduced image.
+   */
+  template<typename TImage, typename TOperator>
+  TImage
+  reduce(const TImage &anImage, typename TImage::Value neutral, const TOperator &op) const
+  {
+    typedef typename TImage::Value Value;
+    const Point extent = anImage.domain().upperBound() - anImage.domain().lowerBound();
+    const std::array<int, 3> size {extent[0] + 1, extent[1] + 1, extent[2] + 1};
+    const std::array<int, 3> pad {std::max(0, std::max(-myLowerBound[0], myUpperBound[0])), 0, 0};
+    PaddedVolume<Value> volume (size, pad);
+    PaddedVolume<Value> result (size, pad);
+    volume.importImage(anImage);
+    reduce(volume, result, neutral, op);
+    TImage imageRes (anImage.domain());
+    result.exportImage(imageRes);
+    return imageRes;
+  }
+
+private:
+  /// memory (in bytes) of the windows of a thread of the reductions.
+  static constexpr std::size_t windowBudget = std::size_t(32) << 20;
+
+  std::vector<Point> myOffsets;
+  std::vector<Run> myRuns;
+  Point myLowerBound;
+  Point myUpperBound;
+};
+
+#endif // STRUCTURING_ELEMENT_3D_H
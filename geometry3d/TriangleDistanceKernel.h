@@ -0,0 +1,166 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+/**
+ * @file TriangleDistanceKernel.h
+ * @ingroup geometry3d
+ *
+ * @date 2026/10/18
+ *
+ * Closest point of a point to a batch of triangles stored as a structure
+ * of arrays (one lane per triangle) to be evaluated with SIMD
+ * instructions.
+ *
+ * This file is part of the DGtal library/DGtalTools-contrib Project.
+ */
+
+#ifndef TRIANGLE_DISTANCE_KERNEL_H
+#define TRIANGLE_DISTANCE_KERNEL_H
+
+#include <cmath>
+
+
+/**
+ * Batch of W triangles (a, a+ab, a+ac) stored as a structure of arrays.
+ * T is float or double, W is typically 4 or 8 (the number of values of
+ * type T in a SIMD register).
+ */
+template<typename T, unsigned int W>
+struct TriangleBatch
+{
+  alignas(64) T ax[W];
+  alignas(64) T ay[W];
+  alignas(64) T az[W];
+  alignas(64) T abx[W];
+  alignas(64) T aby[W];
+  alignas(64) T abz[W];
+  alignas(64) T acx[W];
+  alignas(64) T acy[W];
+  alignas(64) T acz[W];
+
+  /**
+   * Sets the triangle of a lane.
+   */
+  template<typename TPoint>
+  void set(unsigned int lane, const TPoint &a, const TPoint &b, const TPoint &c)
+  {
+    ax[lane] = static_cast<T>(a[0]); ay[lane] = static_cast<T>(a[1]); az[lane] = static_cast<T>(a[2]);
+    abx[lane] = static_cast<T>(b[0] - a[0]); aby[lane] = static_cast<T>(b[1] - a[1]); abz[lane] = static_cast<T>(b[2] - a[2]);
+    acx[lane] = static_cast<T>(c[0] - a[0]); acy[lane] = static_cast<T>(c[1] - a[1]); acz[lane] = static_cast<T>(c[2] - a[2]);
+  }
+};
+
+
+/**
+ * Result of the closest point of a point to a batch of triangles: for
+ * each lane the squared distance, the barycentric coordinates (v, w) of
+ * the closest point a + v ab + w ac and its location (0: inside, 1: on
+ * an edge, 2: on a vertex as the TriangleRegion of MeshFaceBVH.h).
+ */
+template<typename T, unsigned int W>
+struct TriangleBatchResult
+{
+  alignas(64) T squaredDistance[W];
+  alignas(64) T v[W];
+  alignas(64) T w[W];
+  alignas(64) int region[W];
+};
+
+
+/**
+ * Computes the closest point of (px, py, pz) on each triangle of a batch.
+ * This is the region test of C. Ericson (Real-Time Collision Detection,
+ * section 5.1.5) written without branches: the candidates of all the
+ * regions are evaluated and selected, from the last tested region to the
+ * first one, so that the loop over the lanes is vectorized. The
+ * triangles must not be degenerated.
+ */
+template<typename T, unsigned int W>
+void
+closestPointsOnTriangles(const TriangleBatch<T, W> &batch, T px, T py, T pz,
+                         TriangleBatchResult<T, W> &res)
+{
+#pragma omp simd
+  for (unsigned int l = 0; l < W; l++){
+    const T abx = batch.abx[l], aby = batch.aby[l], abz = batch.abz[l];
+    const T acx = batch.acx[l], acy = batch.acy[l], acz = batch.acz[l];
+    const T apx = px - batch.ax[l], apy = py - batch.ay[l], apz = pz - batch.az[l];
+    const T abab = abx*abx + aby*aby + abz*abz;
+    const T abac = abx*acx + aby*acy + abz*acz;
+    const T acac = acx*acx + acy*acy + acz*acz;
+    const T d1 = abx*apx + aby*apy + abz*apz;
+    const T d2 = acx*apx + acy*apy + acz*apz;
+    // bp = ap - ab, cp = ap - ac
+    const T d3 = d1 - abab;
+    const T d4 = d2 - abac;
+    const T d5 = d1 - abac;
+    const T d6 = d2 - acac;
+    const T vc = d1*d4 - d3*d2;
+    const T vb = d5*d2 - d1*d6;
+    const T va = d3*d6 - d5*d4;
+
+    // inside
+    const T sum = va + vb + vc;
+    const T invSum = T(1)/(sum > T(0) ? sum : T(1));
+    T v = vb*invSum;
+    T w = vc*invSum;
+    int region = 0;
+    // edge bc
+    const T e43 = d4 - d3;
+    const T e56 = d5 - d6;
+    const bool onBC = va <= T(0) && e43 >= T(0) && e56 >= T(0) && e43 + e56 > T(0);
+    const T tbc = e43/(e43 + e56 > T(0) ? e43 + e56 : T(1));
+    v = onBC ? T(1) - tbc : v;
+    w = onBC ? tbc : w;
+    region = onBC ? 1 : region;
+    // edge ac
+    const bool onAC = vb <= T(0) && d2 >= T(0) && d6 <= T(0) && d2 - d6 > T(0);
+    const T tac = d2/(d2 - d6 > T(0) ? d2 - d6 : T(1));
+    v = onAC ? T(0) : v;
+    w = onAC ? tac : w;
+    region = onAC ? 1 : region;
+    // vertex c
+    const bool onC = d6 >= T(0) && d5 <= d6;
+    v = onC ? T(0) : v;
+    w = onC ? T(1) : w;
+    region = onC ? 2 : region;
+    // edge ab
+    const bool onAB = vc <= T(0) && d1 >= T(0) && d3 <= T(0) && d1 - d3 > T(0);
+    const T tab = d1/(d1 - d3 > T(0) ? d1 - d3 : T(1));
+    v = onAB ? tab : v;
+    w = onAB ? T(0) : w;
+    region = onAB ? 1 : region;
+    // vertex b
+    const bool onB = d3 >= T(0) && d4 <= d3;
+    v = onB ? T(1) : v;
+    w = onB ? T(0) : w;
+    region = onB ? 2 : region;
+    // vertex a
+    const bool onA = d1 <= T(0) && d2 <= T(0);
+    v = onA ? T(0) : v;
+    w = onA ? T(0) : w;
+    region = onA ? 2 : region;
+
+    const T dx = abx*v + acx*w - apx;
+    const T dy = aby*v + acy*w - apy;
+    const T dz = abz*v + acz*w - apz;
+    res.squaredDistance[l] = dx*dx + dy*dy + dz*dz;
+    res.v[l] = v;
+    res.w[l] = w;
+    res.region[l] = region;
+  }
+}
+
+#endif // TRIANGLE_DISTANCE_KERNEL_H
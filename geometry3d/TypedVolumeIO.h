@@ -0,0 +1,170 @@
+/**
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+/**
+ * @file TypedVolumeIO.h
+ * @ingroup geometry3d
+ *
+ * @date 2026/10/18
+ *
+ * Value type of the voxels of a volume file (vol, longvol, pgm3d, raw)
+ * and import/export of volumes with their own value type, so that the
+ * tools can be instantiated for 8, 16, 32-bit and float volumes.
+ *
+ * This file is part of the DGtal library/DGtalTools-contrib Project.
+ */
+
+#ifndef TYPED_VOLUME_IO_H
+#define TYPED_VOLUME_IO_H
+
+#include <string>
+#include <fstream>
+#include <limits>
+#include <cmath>
+
+#include "DGtal/base/Common.h"
+#include "DGtal/helpers/StdDefs.h"
+#include "DGtal/io/readers/GenericReader.h"
+#include "DGtal/io/readers/RawReader.h"
+#include "DGtal/io/writers/GenericWriter.h"
+#include "DGtal/io/writers/RawWriter.h"
+
+
+/**
+ * Value type of the voxels of a volume.
+ */
+enum class VolumeValueType {UINT8, UINT16, UINT32, FLOAT};
+
+
+/**
+ * @return the extension of a file name (empty if none).
+ */
+inline std::string
+volumeExtension(const std::string &aFileName)
+{
+  const std::size_t pos = aFileName.find_last_of('.');
+  return pos == std::string::npos ? std::string() : aFileName.substr(pos + 1);
+}
+
+
+/**
+ * @param aFileName a volume file.
+ * @param aRawType the type of the values of a raw file (uint8, uint16,
+ * uint32 or float) since raw files have no header.
+ * @return the value type of the voxels: 8 bits for vol files, 8 or 16 bits
+ * for pgm3d files (from the maximal value of their header), 32 bits for
+ * longvol files.
+ */
+inline VolumeValueType
+volumeValueType(const std::string &aFileName, const std::string &aRawType = "uint8")
+{
+  const std::string extension = volumeExtension(aFileName);
+  if (extension == "longvol"){
+    return VolumeValueType::UINT32;
+  }
+  if (extension == "raw"){
+    return aRawType == "uint16" ? VolumeValueType::UINT16 :
+           aRawType == "uint32" ? VolumeValueType::UINT32 :
+           aRawType == "float" ? VolumeValueType::FLOAT : VolumeValueType::UINT8;
+  }
+  if (extension == "pgm3d" || extension == "pgm3D" || extension == "p3d" || extension == "pgm"){
+    // magic number, 3 sizes and maximal value (comments start with #)
+    std::ifstream in (aFileName);
+    std::string token;
+    unsigned int nbTokens = 0;
+    while (nbTokens < 5 && in >> token){
+      if (token[0] == '#'){
+        std::getline(in, token);
+        continue;
+      }
+      nbTokens++;
+    }
+    if (nbTokens == 5 && std::stoul(token) > 255){
+      return VolumeValueType::UINT16;
+    }
+  }
+  return VolumeValueType::UINT8;
+}
+
+
+/**
+ * @return the name of a value type (for the messages of the tools).
+ */
+inline std::string
+volumeValueTypeName(VolumeValueType aType)
+{
+  return aType == VolumeValueType::UINT8 ? "8-bit" :
+         aType == VolumeValueType::UINT16 ? "16-bit" :
+         aType == VolumeValueType::UINT32 ? "32-bit" : "float";
+}
+
+
+/**
+ * Imports a volume (GenericReader, or RawReader for raw files whose values
+ * are read as TImage::Value).
+ *
+ * @param aFileName the volume file.
+ * @param aRawExtent the size of the volume of a raw file.
+ */
+template<typename TImage>
+TImage
+importVolume(const std::string &aFileName, const DGtal::Z3i::Vector &aRawExtent)
+{
+  if (volumeExtension(aFileName) == "raw"){
+    return DGtal::RawReader<TImage>::template importRaw<typename TImage::Value>(aFileName, aRawExtent);
+  }
+  return DGtal::GenericReader<TImage>::import(aFileName);
+}
+
+
+/**
+ * Exports a volume (GenericWriter, or RawWriter for raw files which keep
+ * the value type; longvol files keep integer values). The vol and pgm3d
+ * files are 8-bit: the values of a wider type are rounded and clamped to
+ * [0, 255] (instead of being wrapped by the writer) with a warning if a
+ * voxel is changed.
+ */
+template<typename TImage>
+bool
+exportVolume(const std::string &aFileName, const TImage &anImage)
+{
+  typedef typename TImage::Value Value;
+  const std::string extension = volumeExtension(aFileName);
+  if (extension == "raw"){
+    return DGtal::RawWriter<TImage>::template exportRaw<Value>(aFileName, anImage);
+  }
+  if (extension == "longvol" || (sizeof(Value) == 1 && std::numeric_limits<Value>::is_integer)){
+    return DGtal::GenericWriter<TImage>::exportFile(aFileName, anImage);
+  }
+  TImage image8 (anImage.domain());
+  std::size_t nbChanged = 0;
+  auto out = image8.begin();
+  for (auto it = anImage.begin(); it != anImage.end(); ++it, ++out){
+    const Value v = *it;
+    Value c = v > Value(255) ? Value(255) : (v >= Value(0) ? v : Value(0));
+    if (!std::numeric_limits<Value>::is_integer){
+      c = static_cast<Value>(std::round(c));
+    }
+    if (!(c == v)) nbChanged++;
+    *out = c;
+  }
+  if (nbChanged != 0){
+    DGtal::trace.warning() << nbChanged << " voxels rounded or clamped to [0, 255] in the 8-bit file " << aFileName
+                           << " (use a raw or longvol file to keep the values)." << std::endl;
+  }
+  return DGtal::GenericWriter<TImage>::exportFile(aFileName, image8);
+}
+
+#endif // TYPED_VOLUME_IO_H
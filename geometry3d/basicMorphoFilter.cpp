@@ -42,12 +42,24 @@
    -h,--help                             Print this help message and exit
    -i,--input TEXT:FILE REQUIRED         input file name in 3d volume.
    -o,--output TEXT=result.vol           export the filtered volume extracted
-   -s,--sizeFilter UINT                  size of the filter
+   -s,--sizeFilter UINT=1                size of the filter
    -e,--erode                            apply erosion
    -m,--median                           apply median filter
    -d,--dilate                           apply dilatation
    -c,--closure                          apply closure
+   --opening                             apply opening
+   -p,--operations TEXT Excludes: --erode --median --dilate --closure --opening
+                                         apply a chain of operations e<size> (erosion), d<size> (dilatation) and m<size> (median) separated by commas, for instance "d2,e2,e2,d2" for a closure then an opening.
    -n,--nbRepeat UINT=1                  repeat the selected type of operation
+   --exactBall                           erode or dilate with the exact ball (O(s^3) per voxel) instead of its decomposition into line segments (O(1) per voxel and segment).
+   --structuringElement TEXT:{ball,cube,cross}=ball
+                                         shape of the structuring element of size s: ball (|p| < s), cube ([-s, s]^3) or cross (axis segments [-s, s]).
+   --structuringElementFile TEXT:FILE    use the structuring element of the offsets "x y z" of a text file (one per line) instead of a shape of size s.
+   --binary                              process the volume as a binary volume (the non zero voxels, set to the maximal value in the result) with the exact ball from distance transformations (automatic if the volume has only two values 0 and v).
+   --rawSize UINT x 3                    size X Y Z of a raw input volume.
+   --rawType TEXT:{uint8,uint16,uint32,float}=uint8
+                                         type of the values of a raw input volume (the raw output keeps the input type).
+   --threads UINT=0                      number of threads used to process the slabs of the volume (0: default number of threads).
 
 @endcode
 
@@ -55,6 +67,8 @@
 
  @code
  basicMorphoFilter ${DGtal}/examples/samples/lobster.vol -e lobsErode2_2.vol -s 2 -n 2
+ basicMorphoFilter ${DGtal}/examples/samples/lobster.vol lobsCloseOpen.vol -p "d2,e2,e2,d2"
+ basicMorphoFilter ct.raw --rawSize 512 512 300 --rawType uint16 ctMedian.raw -m -s 2
  @endcode
 
  @see
@@ -64,96 +78,710 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <array>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+#include <map>
+#include <cctype>
 
 #include "DGtal/base/Common.h"
 #include "DGtal/helpers/StdDefs.h"
-#include "DGtal/io/readers/VolReader.h"
-#include "DGtal/io/writers/GenericWriter.h"
 
 #include "DGtal/images/ImageContainerBySTLVector.h"
+#include "DGtal/geometry/volumes/distance/ExactPredicateLpSeparableMetric.h"
+#include "DGtal/geometry/volumes/distance/DistanceTransformation.h"
 
 #include "CLI11.hpp"
 
+#include "StructuringElement3D.h"
+#include "TypedVolumeIO.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 using namespace DGtal;
 
 typedef typename Z3i::Point Point3D;
-typedef ImageContainerBySTLVector<Z3i::Domain, unsigned char> Image3D;
+typedef ImageContainerBySTLVector<Z3i::Domain, bool> BinaryImage3D;
+typedef ExactPredicateLpSeparableMetric<Z3i::Space, 2> L2Metric;
 
 
-// size= width/2
-template<typename TImage>
-TImage
-applyMedian(const TImage &anImage, unsigned int size){
-  unsigned int imageSize = (anImage.domain().upperBound()[0]-anImage.domain().lowerBound()[0])*
-    (anImage.domain().upperBound()[1]-anImage.domain().lowerBound()[1])*
-    (anImage.domain().upperBound()[2]-anImage.domain().lowerBound()[2]);
-  
-  trace.progressBar(0, imageSize);
-  typedef typename TImage::Domain::ConstIterator ImageDomIterator;
-  TImage imageRes (anImage.domain());
-  unsigned int cpt = 0;
-  
-  for(ImageDomIterator it = anImage.domain().begin(); it != anImage.domain().end(); ++it){
-    trace.progressBar(cpt, imageSize);
-    Point3D pt = *it;
-    std::vector<unsigned char> vectVal;
-    for (int k = -(int)size; k <= (int) size; k++) {
-      for (int l = -(int)size; l <= (int) size; l++) {
-        for (int m = -(int)size; m <= (int) size; m++) {
-          Point3D p (((int)(pt[0]))+k, (int)(pt[1])+l, ((int)(pt[2]))+m);
-          if(anImage.domain().isInside(p) && (p-pt).norm() < size ){
-            vectVal.push_back(anImage(p));
-          }          
+/**
+ * Median filter of an 8 or 16-bit volume on a structuring element (the
+ * median is the value of rank n/2 of the n values of the element inside
+ * the domain) with a histogram of the element updated while sliding along
+ * x: moving the element from x-1 to x removes the voxel x-1+xBegin and
+ * adds the voxel x+xEnd of each of its runs (Huang's algorithm in 3D,
+ * O(s^2) updates per voxel for a ball instead of sorting O(s^3) values).
+ * The median is found from coarse bins grouping the fine bins by the high
+ * half of the bits of the values (Perreault and Hebert), so that at most
+ * 32 bins are visited for 8-bit values and 512 for 16-bit values. The
+ * rows are processed in parallel.
+ *
+ * @param volume the input volume (its margin is not used).
+ * @param[out] result the filtered volume (same size).
+ * @param anElement the structuring element.
+ */
+template<typename TValue>
+void
+applyHistogramMedian(const PaddedVolume<TValue> &volume, PaddedVolume<TValue> &result,
+                     const StructuringElement3D &anElement){
+  static_assert(std::numeric_limits<TValue>::is_integer && !std::numeric_limits<TValue>::is_signed &&
+                sizeof(TValue) <= 2, "the histogram median needs 8 or 16-bit unsigned values");
+  constexpr unsigned int nbBits = 8*sizeof(TValue);
+  constexpr unsigned int coarseShift = nbBits/2;
+  constexpr std::size_t nbCoarse = std::size_t(1) << (nbBits - coarseShift);
+  const int nx = volume.size[0];
+  const int ny = volume.size[1];
+  const int nz = volume.size[2];
+  const TValue *values = volume.values.data();
+#pragma omp parallel
+  {
+    std::vector<std::size_t> rowStarts;
+    std::vector<StructuringElement3D::Run> rowRuns;
+    std::vector<unsigned int> coarse (nbCoarse, 0);
+    std::vector<unsigned int> fine (std::size_t(1) << nbBits, 0);
+#pragma omp for schedule(dynamic, 1)
+    for (int z = 0; z < nz; z++){
+      for (int y = 0; y < ny; y++){
+        // runs inside the domain: index of their voxel at x = 0
+        rowStarts.clear();
+        rowRuns.clear();
+        for (const auto &r: anElement.runs()){
+          if (y + r.dy >= 0 && y + r.dy < ny && z + r.dz >= 0 && z + r.dz < nz){
+            rowStarts.push_back(volume.index(0, y + r.dy, z + r.dz));
+            rowRuns.push_back(r);
+          }
+        }
+        // only the non empty coarse bins have non empty fine bins
+        for (std::size_t b = 0; b < nbCoarse; b++){
+          if (coarse[b] != 0){
+            std::fill(fine.begin() + (b << coarseShift), fine.begin() + ((b + 1) << coarseShift), 0);
+            coarse[b] = 0;
+          }
+        }
+        unsigned int count = 0;
+        for (std::size_t c = 0; c < rowRuns.size(); c++){
+          for (int x = std::max(0, rowRuns[c].xBegin); x <= std::min(rowRuns[c].xEnd, nx - 1); x++){
+            const std::size_t v = values[rowStarts[c] + x];
+            coarse[v >> coarseShift]++; fine[v]++; count++;
+          }
+        }
+        TValue *itRes = result.values.data() + result.index(0, y, z);
+        for (int x = 0; x < nx; x++){
+          if (x > 0){
+            for (std::size_t c = 0; c < rowRuns.size(); c++){
+              const int xr = x - 1 + rowRuns[c].xBegin;
+              if (xr >= 0 && xr < nx){
+                const std::size_t v = values[rowStarts[c] + xr];
+                coarse[v >> coarseShift]--; fine[v]--; count--;
+              }
+              const int xa = x + rowRuns[c].xEnd;
+              if (xa >= 0 && xa < nx){
+                const std::size_t v = values[rowStarts[c] + xa];
+                coarse[v >> coarseShift]++; fine[v]++; count++;
+              }
+            }
+          }
+          if (count == 0){
+            // empty neighborhood: the value is kept
+            *itRes++ = values[volume.index(x, y, z)];
+            continue;
+          }
+          const unsigned int rank = count/2;
+          unsigned int cumul = 0;
+          std::size_t b = 0;
+          while (cumul + coarse[b] <= rank) cumul += coarse[b++];
+          std::size_t v = b << coarseShift;
+          while (cumul + fine[v] <= rank) cumul += fine[v++];
+          *itRes++ = static_cast<TValue>(v);
+        }
+      }
+    }
+  }
+}
+
+
+/**
+ * Median filter for the values without histogram (32-bit integers and
+ * floats): the values of the element inside the domain are gathered in a
+ * buffer reused for all the voxels of a thread and the value of rank n/2
+ * is selected in linear time.
+ *
+ * @param volume the input volume (its margin is not used).
+ * @param[out] result the filtered volume (same size).
+ * @param anElement the structuring element.
+ */
+template<typename TValue>
+void
+applySelectionMedian(const PaddedVolume<TValue> &volume, PaddedVolume<TValue> &result,
+                     const StructuringElement3D &anElement){
+  const int nx = volume.size[0];
+  const int ny = volume.size[1];
+  const int nz = volume.size[2];
+#pragma omp parallel
+  {
+    std::vector<TValue> neighbors;
+    neighbors.reserve(anElement.size());
+#pragma omp for schedule(dynamic, 1)
+    for (int z = 0; z < nz; z++){
+      for (int y = 0; y < ny; y++){
+        for (int x = 0; x < nx; x++){
+          neighbors.clear();
+          for (const auto &r: anElement.runs()){
+            if (y + r.dy < 0 || y + r.dy >= ny || z + r.dz < 0 || z + r.dz >= nz) continue;
+            const TValue *row = volume.values.data() + volume.index(0, y + r.dy, z + r.dz);
+            for (int xn = std::max(0, x + r.xBegin); xn <= std::min(nx - 1, x + r.xEnd); xn++){
+              neighbors.push_back(row[xn]);
+            }
+          }
+          TValue v = volume.values[volume.index(x, y, z)];
+          if (!neighbors.empty()){
+            std::nth_element(neighbors.begin(), neighbors.begin() + neighbors.size()/2, neighbors.end());
+            v = neighbors[neighbors.size()/2];
+          }
+          result.values[result.index(x, y, z)] = v;
+        }
+      }
+    }
+  }
+}
+
+
+template<typename TValue>
+void
+applyMedian(const PaddedVolume<TValue> &volume, PaddedVolume<TValue> &result,
+            const StructuringElement3D &anElement){
+  if constexpr (std::numeric_limits<TValue>::is_integer && sizeof(TValue) <= 2){
+    applyHistogramMedian(volume, result, anElement);
+  }else{
+    applySelectionMedian(volume, result, anElement);
+  }
+}
+
+
+
+/**
+ * Erosion or dilation of a volume by a structuring element (reduction of
+ * the element over the rows of the volume, see StructuringElement3D).
+ *
+ * @param volume the input volume (its margin is modified).
+ * @param[out] result the filtered volume (same size and margin).
+ * @param anElement the structuring element.
+ * @param isErode if true an erosion, otherwise a dilation.
+ */
+template<typename TValue>
+void
+applyElementErodeDilate(PaddedVolume<TValue> &volume, PaddedVolume<TValue> &result,
+                        const StructuringElement3D &anElement, bool isErode)
+{
+  if (isErode){
+    anElement.reduce(volume, result, std::numeric_limits<TValue>::max(),
+                     [](TValue a, TValue b){ return std::min(a, b); });
+  }else{
+    anElement.reduce(volume, result, std::numeric_limits<TValue>::lowest(),
+                     [](TValue a, TValue b){ return std::max(a, b); });
+  }
+}
+
+
+
+/**
+ * Digital segment of a ball decomposition: the points k direction with
+ * -halfLength <= k <= halfLength.
+ */
+struct LineSegment3D
+{
+  std::array<int, 3> direction;
+  unsigned int halfLength;
+};
+
+// the 3 axes, the 6 face diagonals and the 4 cube diagonals.
+static const int lineDirections[13][3] = {
+  {1, 0, 0}, {0, 1, 0}, {0, 0, 1},
+  {1, 1, 0}, {1, -1, 0}, {1, 0, 1}, {1, 0, -1}, {0, 1, 1}, {0, 1, -1},
+  {1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {1, -1, -1}};
+
+
+/**
+ * Approximates the ball {p : |p| < size} used by the exact filters by a
+ * Minkowski sum of digital segments along the 13 directions of
+ * lineDirections, with the same length ka (resp. kf, kb) for the axes
+ * (resp. face and cube diagonals). The resulting polyhedron has the
+ * support function ka A(u) + kf F(u) + kb B(u) with A, F and B the sums
+ * of |d.u| over each family of directions d: the lengths are chosen to
+ * minimize the maximal difference with the support function of the
+ * digital ball over directions of the first octant (both shapes have the
+ * symmetries of the cube). Since ka >= 1, the sum has no hole.
+ *
+ * @param size the size of the ball.
+ * @param[out] maxError the maximal difference of the support functions.
+ * @return the segments (empty if the ball is reduced to its center).
+ */
+std::vector<LineSegment3D>
+ballDecomposition(unsigned int size, double &maxError)
+{
+  std::vector<LineSegment3D> res;
+  maxError = 0.0;
+  if (size <= 1) return res;
+  const int r2 = static_cast<int>(size*size);
+  const unsigned int nbSteps = 16;
+  // support function of the ball, of the axes, face and cube diagonals
+  std::vector<std::array<double, 4>> supports;
+  for (unsigned int i = 0; i <= nbSteps; i++){
+    for (unsigned int j = 0; j <= nbSteps; j++){
+      const double theta = M_PI/2.0*i/nbSteps;
+      const double phi = M_PI/2.0*j/nbSteps;
+      const double u[3] = {std::sin(theta)*std::cos(phi), std::sin(theta)*std::sin(phi),
+                           std::cos(theta)};
+      std::array<double, 4> s {0.0, 0.0, 0.0, 0.0};
+      // the extreme points of the ball are on top of its columns
+      for (int x = 0; x*x < r2; x++){
+        for (int y = 0; x*x + y*y < r2; y++){
+          int z = static_cast<int>(std::sqrt(static_cast<double>(r2 - x*x - y*y)));
+          while (z > 0 && x*x + y*y + z*z >= r2) z--;
+          s[0] = std::max(s[0], x*u[0] + y*u[1] + z*u[2]);
+        }
+      }
+      for (unsigned int d = 0; d < 13; d++){
+        s[d < 3 ? 1 : (d < 9 ? 2 : 3)] += std::abs(lineDirections[d][0]*u[0] +
+                                                   lineDirections[d][1]*u[1] +
+                                                   lineDirections[d][2]*u[2]);
+      }
+      supports.push_back(s);
+    }
+  }
+  // the support along the axes (size - 1) is ka + 4 kf + 4 kb
+  const int axisSupport = static_cast<int>(size) - 1;
+  int best[3] = {axisSupport, 0, 0};
+  maxError = std::numeric_limits<double>::max();
+  for (int kf = 0; 4*kf <= axisSupport; kf++){
+    for (int kb = 0; 4*(kf + kb) <= axisSupport; kb++){
+      const int ka0 = axisSupport - 4*(kf + kb);
+      for (int ka = std::max(1, ka0 - 1); ka <= ka0 + 1; ka++){
+        double error = 0.0;
+        for (const auto &s: supports){
+          error = std::max(error, std::abs(ka*s[1] + kf*s[2] + kb*s[3] - s[0]));
+        }
+        if (error < maxError - 1e-9){
+          maxError = error;
+          best[0] = ka; best[1] = kf; best[2] = kb;
+        }
+      }
+    }
+  }
+  for (unsigned int d = 0; d < 13; d++){
+    const int k = best[d < 3 ? 0 : (d < 9 ? 1 : 2)];
+    if (k > 0){
+      res.push_back({{lineDirections[d][0], lineDirections[d][1], lineDirections[d][2]},
+                     static_cast<unsigned int>(k)});
+    }
+  }
+  return res;
+}
+
+
+/**
+ * Replaces the n values of a line by their minimum (or maximum) over a
+ * window of 2k+1 values centered on each value, with the algorithm of
+ * van Herk and Gil-Werman: the line (padded with k neutral values on each
+ * side) is cut in blocks of 2k+1 values in which the running extremum is
+ * computed forward (g) and backward (h), so that the window extremum is
+ * op(h[i], g[i+2k]) whatever k (3 comparisons per value).
+ *
+ * @param line the values (updated).
+ * @param n the number of values of the line.
+ * @param k the half width of the window.
+ * @param neutral the neutral value of op.
+ * @param op the min or max operator.
+ * @param g,h buffers of at least n + 2k values.
+ */
+template<typename TValue, typename TOperator>
+void
+runningExtremum(std::vector<TValue> &line, std::size_t n, unsigned int k,
+                TValue neutral, const TOperator &op,
+                std::vector<TValue> &g, std::vector<TValue> &h)
+{
+  const std::size_t w = 2*k + 1;
+  const std::size_t m = n + 2*k;
+  for (std::size_t j = 0; j < m; j++){
+    const TValue v = (j < k || j >= n + k) ? neutral : line[j - k];
+    g[j] = (j % w == 0) ? v : op(g[j - 1], v);
+  }
+  for (std::size_t j = m; j-- > 0;){
+    const TValue v = (j < k || j >= n + k) ? neutral : line[j - k];
+    h[j] = (j % w == w - 1 || j == m - 1) ? v : op(h[j + 1], v);
+  }
+  for (std::size_t i = 0; i < n; i++){
+    line[i] = op(h[i], g[i + 2*k]);
+  }
+}
+
+
+/**
+ * Applies the running extremum of a segment along all the lines of its
+ * direction in a volume (margin included). The lines are independent and
+ * are processed in parallel.
+ */
+template<typename TValue, typename TOperator>
+void
+applyLineSegment(PaddedVolume<TValue> &volume, const LineSegment3D &segment,
+                 TValue neutral, const TOperator &op)
+{
+  const std::array<int, 3> &d = segment.direction;
+  const std::array<int, 3> &dims = volume.dims;
+  const long offset = d[0] + static_cast<long>(dims[0])*(d[1] + static_cast<long>(dims[1])*d[2]);
+  const std::size_t maxLength = *std::max_element(dims.begin(), dims.end());
+  // a line starts at each point p such that p - d is outside the volume:
+  // on the first or last plane orthogonal to an axis a with d[a] != 0.
+  std::array<int, 3> start;
+  for (unsigned int a = 0; a < 3; a++){
+    start[a] = d[a] > 0 ? 0 : dims[a] - 1;
+  }
+#pragma omp parallel
+  {
+    std::vector<TValue> line(maxLength);
+    std::vector<TValue> g(maxLength + 2*segment.halfLength);
+    std::vector<TValue> h(maxLength + 2*segment.halfLength);
+    for (unsigned int a = 0; a < 3; a++){
+      if (d[a] == 0) continue;
+      const unsigned int b = (a + 1) % 3;
+      const unsigned int c = (a + 2) % 3;
+#pragma omp for schedule(static)
+      for (int j = 0; j < dims[c]; j++){
+        for (int i = 0; i < dims[b]; i++){
+          std::array<int, 3> p;
+          p[a] = start[a]; p[b] = i; p[c] = j;
+          bool isStarted = false;
+          std::size_t n = maxLength;
+          for (unsigned int e = 0; e < 3; e++){
+            if (d[e] == 0) continue;
+            isStarted = isStarted || (e < a && p[e] == start[e]);
+            n = std::min(n, static_cast<std::size_t>(d[e] > 0 ? dims[e] - p[e] : p[e] + 1));
+          }
+          if (isStarted) continue;
+          const long first = p[0] + static_cast<long>(dims[0])*(p[1] + static_cast<long>(dims[1])*p[2]);
+          for (std::size_t k = 0; k < n; k++){
+            line[k] = volume.values[first + static_cast<long>(k)*offset];
+          }
+          runningExtremum(line, n, segment.halfLength, neutral, op, g, h);
+          for (std::size_t k = 0; k < n; k++){
+            volume.values[first + static_cast<long>(k)*offset] = line[k];
+          }
         }
       }
     }
-    std::sort(vectVal.begin(), vectVal.end());
-    imageRes.setValue(pt, vectVal[vectVal.size()/2.0]);
-    cpt++;
   }
-  return imageRes;
+}
+
+
+/**
+ * Erosion or dilation by a ball decomposed into line segments (see
+ * ballDecomposition) in O(n) per segment whatever the size, in place. The
+ * margin of the volume (at least the extent of the Minkowski sum of the
+ * segments) is set to the neutral value so that the successive passes
+ * give the erosion (dilation) by the sum of the segments restricted to
+ * the domain, as the exact filter.
+ */
+template<typename TValue>
+void
+applyDecomposedErodeDilate(PaddedVolume<TValue> &volume,
+                           const std::vector<LineSegment3D> &segments, bool isErode)
+{
+  const TValue neutral = isErode ? std::numeric_limits<TValue>::max() : std::numeric_limits<TValue>::lowest();
+  volume.fillPadding(neutral);
+  for (const auto &s: segments){
+    if (isErode){
+      applyLineSegment(volume, s, neutral, [](TValue a, TValue b){ return std::min(a, b); });
+    }else{
+      applyLineSegment(volume, s, neutral, [](TValue a, TValue b){ return std::max(a, b); });
+    }
+  }
+}
+
+
+/**
+ * @return the extent along each axis of the Minkowski sum of segments.
+ */
+std::array<int, 3>
+segmentsExtent(const std::vector<LineSegment3D> &segments)
+{
+  std::array<int, 3> extent {0, 0, 0};
+  for (const auto &s: segments){
+    for (unsigned int a = 0; a < 3; a++){
+      extent[a] += static_cast<int>(s.halfLength)*std::abs(s.direction[a]);
+    }
+  }
+  return extent;
+}
+
+
+/**
+ * Adds segments to a Minkowski sum of segments (the half lengths of the
+ * segments of the same direction are added).
+ */
+void
+addSegments(std::vector<LineSegment3D> &sum, const std::vector<LineSegment3D> &segments)
+{
+  for (const auto &s: segments){
+    auto it = std::find_if(sum.begin(), sum.end(), [&s](const LineSegment3D &t){
+      return t.direction == s.direction;
+    });
+    if (it == sum.end()){
+      sum.push_back(s);
+    }else{
+      it->halfLength += s.halfLength;
+    }
+  }
 }
 
 
 
-// size= width/2
+/**
+ * Erosion or dilation of a binary volume (the non zero voxels) by the
+ * exact ball |p - q| < size from a distance transformation: a voxel stays
+ * in the erosion if its distance to the background is at least size and
+ * is in the dilation if its distance to the foreground is less than size.
+ * The distance transformation is computed in linear time by separable
+ * passes (in parallel if DGtal is built with OpenMP), so the cost does not
+ * depend on the size.
+ *
+ * @param anImage the binary volume.
+ * @param size the size of the ball.
+ * @param isErode erosion if true, dilation otherwise.
+ * @param foregroundValue the value of the foreground in the result.
+ */
 template<typename TImage>
 TImage
-applyErodeDilate(const TImage &anImage, unsigned int size, bool isErode){
-  unsigned int imageSize = (anImage.domain().upperBound()[0]-anImage.domain().lowerBound()[0])*
-    (anImage.domain().upperBound()[1]-anImage.domain().lowerBound()[1])*
-    (anImage.domain().upperBound()[2]-anImage.domain().lowerBound()[2]);
- 
-  trace.progressBar(0, imageSize);
-  typedef typename TImage::Domain::ConstIterator ImageDomIterator;
+applyBinaryErodeDilate(const TImage &anImage, unsigned int size, bool isErode,
+                       typename TImage::Value foregroundValue)
+{
+  typedef typename TImage::Value Value;
+  // the distance is computed to the voxels where the predicate is false
+  BinaryImage3D predicate (anImage.domain());
+  std::transform(anImage.begin(), anImage.end(), predicate.begin(),
+                 [isErode](Value v){ return (v != 0) == isErode; });
   TImage imageRes (anImage.domain());
-  unsigned int cpt = 0;
-
-  for(ImageDomIterator it = anImage.domain().begin(); it != anImage.domain().end(); ++it){
-    trace.progressBar(cpt, imageSize);
-    Point3D pt = *it;
-    unsigned char extremVal = isErode?  std::numeric_limits<unsigned char>::max():0;
-    for (int k = -(int)size; k <= (int) size; k++) {
-      for (int l = -(int)size; l <= (int) size; l++) {
-        for (int m = -(int)size; m <= (int) size; m++) {
-          Point3D p (((int)(pt[0]))+k, (int)(pt[1])+l, ((int)(pt[2]))+m);
-          if (anImage.domain().isInside(p) && (p-pt).norm() < size ) {
-            if(extremVal > anImage(p) && isErode){
-              extremVal = anImage(p);
-            }
-            if(extremVal < anImage(p) && !isErode){
-              extremVal = anImage(p);
-            }
-          }
+  if (std::find(predicate.begin(), predicate.end(), false) == predicate.end()){
+    // no background (erosion) or no foreground (dilation)
+    std::fill(imageRes.begin(), imageRes.end(), isErode ? foregroundValue : 0);
+    return imageRes;
+  }
+  L2Metric l2;
+  DistanceTransformation<Z3i::Space, BinaryImage3D, L2Metric> dt (&predicate.domain(), &predicate, &l2);
+  auto itRes = imageRes.begin();
+  for (auto it = anImage.domain().begin(); it != anImage.domain().end(); ++it){
+    const double d = dt(*it);
+    *itRes++ = (isErode ? d >= size : d < size) ? foregroundValue : 0;
+  }
+  return imageRes;
+}
+
+
+
+/**
+ * Operation of a chain: erosion ('e'), dilation ('d') or median ('m') with
+ * a structuring element of a given size.
+ */
+struct MorphoOperation
+{
+  char type;
+  unsigned int size;
+};
+
+
+/**
+ * Parses a chain of operations such as "d2,e2,e2,d2" (a closing then an
+ * opening with elements of size 2).
+ *
+ * @param aChain the operations separated by commas.
+ * @param[out] operations the parsed operations.
+ * @return false if the chain is not valid.
+ */
+bool
+parseOperations(const std::string &aChain, std::vector<MorphoOperation> &operations)
+{
+  std::stringstream stream(aChain);
+  std::string item;
+  while (std::getline(stream, item, ',')){
+    item.erase(std::remove(item.begin(), item.end(), ' '), item.end());
+    if (item.size() < 2 || std::string("edm").find(item[0]) == std::string::npos ||
+        !std::all_of(item.begin() + 1, item.end(), [](char c){ return std::isdigit(c) != 0; })){
+      return false;
+    }
+    operations.push_back({item[0], static_cast<unsigned int>(std::stoul(item.substr(1)))});
+  }
+  return !operations.empty();
+}
+
+
+/**
+ * Filter of one or several consecutive operations of a chain: the
+ * decomposition of the element into line segments (consecutive erosions
+ * or dilations are fused into the decomposition of the Minkowski sum of
+ * their elements), the element itself (for a median or when it is not
+ * decomposed) or a distance transformation (binary volumes).
+ */
+struct MorphoStep
+{
+  enum Method {DECOMPOSITION, ELEMENT, DISTANCE};
+  Method method;
+  char type;
+  unsigned int size;
+  unsigned int nbOperations;
+  std::vector<LineSegment3D> segments;
+  const StructuringElement3D *element;
+};
+
+
+
+/**
+ * Parameters of the filters.
+ */
+struct FilterParameters
+{
+  std::vector<MorphoOperation> operations;
+  std::string elementShape;
+  std::string elementFileName;
+  bool exactBall;
+  bool binary;
+};
+
+
+/**
+ * Reads a volume with values of type TValue, applies the chain of
+ * operations and exports the result.
+ *
+ * @param inputFileName the input volume.
+ * @param outputFileName the output volume.
+ * @param rawExtent the size of a raw input volume.
+ * @param params the operations and the structuring element.
+ */
+template<typename TValue>
+void
+filterVolume(const std::string &inputFileName, const std::string &outputFileName,
+             const Z3i::Vector &rawExtent, const FilterParameters &params)
+{
+  typedef ImageContainerBySTLVector<Z3i::Domain, TValue> Image;
+  Image inputImage = importVolume<Image>(inputFileName, rawExtent);
+  const std::vector<MorphoOperation> &operations = params.operations;
+  const std::string &elementShape = params.elementShape;
+  const std::string &elementFileName = params.elementFileName;
+  bool binary = params.binary;
+
+  const bool isBall = elementFileName.empty() && elementShape == "ball";
+  const bool isCube = elementFileName.empty() && elementShape == "cube";
+  const TValue foregroundValue = *std::max_element(inputImage.begin(), inputImage.end());
+  if (binary && !isBall) {
+    trace.warning() << "--binary is only used with a ball structuring element" << std::endl;
+    binary = false;
+  }
+  if (!binary && isBall) {
+    binary = std::all_of(inputImage.begin(), inputImage.end(),
+                         [foregroundValue](TValue v){ return v == 0 || v == foregroundValue; });
+    if (binary) {
+      trace.info() << "binary volume (0 and " << +foregroundValue << "): "
+                   << "exact ball from distance transformations" << std::endl;
+    }
+  }
+
+  // filters of the operations: the ball (unless --exactBall) and the cube
+  // (exactly) are decomposed into line segments.
+  std::map<unsigned int, StructuringElement3D> elements;
+  std::vector<MorphoStep> steps;
+  for (const auto &op: operations) {
+    const bool isMorpho = op.type != 'm';
+    if (isMorpho && binary) {
+      steps.push_back({MorphoStep::DISTANCE, op.type, op.size, 1, {}, nullptr});
+    }else if (isMorpho && (isCube || (isBall && !params.exactBall))) {
+      std::vector<LineSegment3D> segments;
+      if (isBall) {
+        double decompositionError {0.0};
+        segments = ballDecomposition(op.size, decompositionError);
+        trace.info() << "ball of size " << op.size << " decomposed into " << segments.size()
+                     << " line segments (max support difference " << decompositionError << ")" << std::endl;
+      }else if (op.size > 0) {
+        for (unsigned int d = 0; d < 3; d++) {
+          segments.push_back({{lineDirections[d][0], lineDirections[d][1], lineDirections[d][2]}, op.size});
         }
       }
+      if (!steps.empty() && steps.back().method == MorphoStep::DECOMPOSITION && steps.back().type == op.type) {
+        addSegments(steps.back().segments, segments);
+        steps.back().nbOperations++;
+      }else {
+        steps.push_back({MorphoStep::DECOMPOSITION, op.type, op.size, 1, segments, nullptr});
+      }
+    }else {
+      auto it = elements.find(op.size);
+      if (it == elements.end()) {
+        it = elements.emplace(op.size,
+                              !elementFileName.empty() ? StructuringElement3D::fromFile(elementFileName) :
+                              elementShape == "cube" ? StructuringElement3D::cube(op.size) :
+                              elementShape == "cross" ? StructuringElement3D::cross(op.size) :
+                              StructuringElement3D::ball(op.size)).first;
+        trace.info() << "structuring element of size " << op.size << ": "
+                     << it->second.size() << " voxels" << std::endl;
+      }
+      steps.push_back({MorphoStep::ELEMENT, op.type, op.size, 1, {}, &it->second});
     }
-    
-    imageRes.setValue(pt, extremVal);
-    cpt++;
   }
-  return imageRes;
+
+  // margin of the volume: the extent of the largest element
+  std::array<int, 3> pad {0, 0, 0};
+  bool needsResultVolume = false;
+  for (const auto &step: steps) {
+    std::array<int, 3> extent {0, 0, 0};
+    if (step.method == MorphoStep::DECOMPOSITION) {
+      extent = segmentsExtent(step.segments);
+    }else if (step.method == MorphoStep::ELEMENT) {
+      needsResultVolume = true;
+      if (step.type != 'm') {
+        for (unsigned int a = 0; a < 3; a++) {
+          extent[a] = std::max(0, std::max(-step.element->lowerBound()[a], step.element->upperBound()[a]));
+        }
+      }
+    }
+    for (unsigned int a = 0; a < 3; a++) {
+      pad[a] = std::max(pad[a], extent[a]);
+    }
+  }
+  const Point3D extent = inputImage.domain().upperBound() - inputImage.domain().lowerBound();
+  const std::array<int, 3> size {extent[0] + 1, extent[1] + 1, extent[2] + 1};
+  PaddedVolume<TValue> volume (size, pad);
+  PaddedVolume<TValue> result (needsResultVolume ? size : std::array<int, 3> {0, 0, 0},
+                                      needsResultVolume ? pad : std::array<int, 3> {0, 0, 0});
+  volume.importImage(inputImage);
+
+  for (const auto &step: steps) {
+    trace.info() << "applying " << (step.type == 'm' ? "median" : (step.type == 'e' ? "erosion": "dilatation"));
+    if (step.nbOperations > 1) {
+      trace.info() << " (" << step.nbOperations << " operations fused)";
+    }
+    trace.info() << std::endl;
+    if (step.method == MorphoStep::DECOMPOSITION) {
+      applyDecomposedErodeDilate(volume, step.segments, step.type == 'e');
+    }else if (step.method == MorphoStep::ELEMENT) {
+      if (step.type == 'm') {
+        applyMedian(volume, result, *step.element);
+      }else {
+        applyElementErodeDilate(volume, result, *step.element, step.type == 'e');
+      }
+      std::swap(volume, result);
+    }else {
+      volume.exportImage(inputImage);
+      inputImage = applyBinaryErodeDilate(inputImage, step.size, step.type == 'e', foregroundValue);
+      volume.importImage(inputImage);
+    }
+  }
+  volume.exportImage(inputImage);
+
+  trace.info() << std::endl;
+  exportVolume(outputFileName, inputImage);
 }
 
 
@@ -162,19 +790,27 @@ int
 main(int argc,char **argv)
 
 {
-  typedef typename Image3D::Domain::ConstIterator ImageDomIterator;
   // parse command line using CLI ----------------------------------------------
   CLI::App app;
   app.description("Apply basic morpho filter from a ball structural element.\n Example:"
                   "./geometry3d/basicMorphoFilter ${DGtal}/examples/samples/lobster.vol -e lobsErode2_2.vol -s 2 -n 2");
   std::string inputFileName;
   std::string outputFileName {"result.vol"};
-  unsigned int sizeFilter;
+  unsigned int sizeFilter {1};
   unsigned int nbRepeat {1};
   bool erode {false};
   bool dilate {false};
   bool median {false};
   bool closure {false};
+  bool opening {false};
+  bool exactBall {false};
+  bool binary {false};
+  std::string elementShape {"ball"};
+  std::string elementFileName;
+  std::string operationChain;
+  unsigned int nbThreads {0};
+  std::vector<unsigned int> rawSize {0, 0, 0};
+  std::string rawType {"uint8"};
   
   
   app.add_option("-i,--input,1", inputFileName, "input file name in 3d volume." )
@@ -182,48 +818,74 @@ main(int argc,char **argv)
   ->check(CLI::ExistingFile);
   app.add_option("--output,-o,2", outputFileName, "export the filtered volume extracted");
   app.add_option("--sizeFilter,-s", sizeFilter, "size of the filter");
-  app.add_flag("--erode,-e", erode, "apply erosion");
-  app.add_flag("--median,-m", median, "apply median filter");
-  app.add_flag("--dilate,-d", dilate, "apply dilatation");
-  app.add_flag("--closure,-c", "apply closure");
+  auto erodeOpt = app.add_flag("--erode,-e", erode, "apply erosion");
+  auto medianOpt = app.add_flag("--median,-m", median, "apply median filter");
+  auto dilateOpt = app.add_flag("--dilate,-d", dilate, "apply dilatation");
+  auto closureOpt = app.add_flag("--closure,-c", closure, "apply closure");
+  auto openingOpt = app.add_flag("--opening", opening, "apply opening");
+  app.add_option("--operations,-p", operationChain, "apply a chain of operations e<size> (erosion), d<size> (dilatation) and m<size> (median) separated by commas, for instance \"d2,e2,e2,d2\" for a closure then an opening.")
+  ->excludes(erodeOpt)->excludes(medianOpt)->excludes(dilateOpt)->excludes(closureOpt)->excludes(openingOpt);
   app.add_option("--nbRepeat,-n",nbRepeat, "repeat the selected type of operation");
+  app.add_flag("--exactBall", exactBall, "erode or dilate with the exact ball (O(s^3) per voxel) instead of its decomposition into line segments (O(1) per voxel and segment).");
+  app.add_option("--structuringElement", elementShape, "shape of the structuring element of size s: ball (|p| < s), cube ([-s, s]^3) or cross (axis segments [-s, s]).")
+  ->check(CLI::IsMember({"ball", "cube", "cross"}));
+  app.add_option("--structuringElementFile", elementFileName, "use the structuring element of the offsets \"x y z\" of a text file (one per line) instead of a shape of size s.")
+  ->check(CLI::ExistingFile);
+  app.add_flag("--binary", binary, "process the volume as a binary volume (the non zero voxels, set to the maximal value in the result) with the exact ball from distance transformations (automatic if the volume has only two values 0 and v).");
+  app.add_option("--rawSize", rawSize, "size X Y Z of a raw input volume.")
+  ->expected(3);
+  app.add_option("--rawType", rawType, "type of the values of a raw input volume (the raw output keeps the input type).")
+  ->check(CLI::IsMember({"uint8", "uint16", "uint32", "float"}));
+  app.add_option("--threads", nbThreads, "number of threads used to process the slabs of the volume (0: default number of threads).");
   
   
   app.get_formatter()->column_width(40);
   CLI11_PARSE(app, argc, argv);
   // END parse command line using CLI ----------------------------------------------
-  
-  Image3D inputImage = VolReader<Image3D>::importVol(inputFileName);
-  Image3D imageRes(inputImage);
 
-  for(ImageDomIterator it = inputImage.domain().begin(); it != inputImage.domain().end(); it++){
-    imageRes.setValue(*it,inputImage(*it));
+#ifdef _OPENMP
+  if (nbThreads != 0){
+    omp_set_num_threads(nbThreads);
   }
+#endif
 
-  for (unsigned int i=0; i<nbRepeat; i++) {    
-    if(median){
-      trace.info() << std::endl;
-      trace.info() << "applying " << "median" << std::endl;
-      imageRes = applyMedian(imageRes, sizeFilter);
-      trace.info() << std::endl;
-      
-    }
-    else if (!closure) {
-      trace.info() << std::endl;
-      trace.info() << "applying " << (erode ? "erosion": "dilatation") << std::endl;
-      imageRes = applyErodeDilate(imageRes, sizeFilter, !dilate);
-      trace.info() << std::endl;
-
-    }else if(!median) {
-      trace.info() << "applying " << "closure" << std::endl;
-      trace.info() << "applying " << "dilate" << std::endl;
-      imageRes = applyErodeDilate(imageRes, sizeFilter, false);
-      trace.info() << "applying " << "erode" << std::endl;
-      imageRes = applyErodeDilate(imageRes, sizeFilter, true);
+  std::vector<MorphoOperation> chain;
+  if (!operationChain.empty()) {
+    if (!parseOperations(operationChain, chain)) {
+      trace.error() << "invalid chain of operations: " << operationChain << std::endl;
+      return 1;
     }
+  }else if (median) {
+    chain.push_back({'m', sizeFilter});
+  }else if (closure) {
+    chain = {{'d', sizeFilter}, {'e', sizeFilter}};
+  }else if (opening) {
+    chain = {{'e', sizeFilter}, {'d', sizeFilter}};
+  }else {
+    chain.push_back({dilate ? 'd' : 'e', sizeFilter});
   }
-
-  trace.info() << std::endl;
-  imageRes >>  outputFileName;
-    
+  std::vector<MorphoOperation> operations;
+  for (unsigned int i=0; i<nbRepeat; i++) {
+    operations.insert(operations.end(), chain.begin(), chain.end());
+  }
+  
+  const Z3i::Vector rawExtent (rawSize[0], rawSize[1], rawSize[2]);
+  const VolumeValueType valueType = volumeValueType(inputFileName, rawType);
+  trace.info() << "input volume: " << volumeValueTypeName(valueType) << " values" << std::endl;
+  const FilterParameters params {operations, elementShape, elementFileName, exactBall, binary};
+  switch (valueType) {
+  case VolumeValueType::UINT8:
+    filterVolume<DGtal::uint8_t>(inputFileName, outputFileName, rawExtent, params);
+    break;
+  case VolumeValueType::UINT16:
+    filterVolume<DGtal::uint16_t>(inputFileName, outputFileName, rawExtent, params);
+    break;
+  case VolumeValueType::UINT32:
+    filterVolume<DGtal::uint32_t>(inputFileName, outputFileName, rawExtent, params);
+    break;
+  case VolumeValueType::FLOAT:
+    filterVolume<float>(inputFileName, outputFileName, rawExtent, params);
+    break;
+  }
+  return 0;
 }
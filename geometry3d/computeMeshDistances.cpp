@@ -36,20 +36,39 @@
  
  Positionals:
    1 TEXT:FILE REQUIRED                  input file name of mesh A (reference shape) given as OFF format.
-   2 TEXT:FILE REQUIRED                  input file name of mesh B (compared shape) given as OFF format.
+   2 TEXT:FILE                           input file name of mesh B (compared shape) given as OFF format.
    minScaleDistance FLOAT=0              set the default min value use to display the distance
 
  Options:
    -h,--help                             Print this help message and exit
    -i,--input TEXT:FILE REQUIRED         input file name of mesh A (reference shape) given as OFF format.
-   -c,--inputComp TEXT:FILE REQUIRED     input file name of mesh B (compared shape) given as OFF format.
+   -c,--inputComp TEXT:FILE Excludes: --candidates
+                                         input file name of mesh B (compared shape) given as OFF format.
    -o,--output TEXT                      arg = file.dat : output file containing all the distances of each input mesh faces (faces of A)
-   -m,--outputMesh TEXT                  arg = file.off : export the resulting distances represented with a color scale on the faces of the reference mesh A.
+   -m,--outputMesh TEXT                  arg = file.off : export the resulting distances represented with a color scale on the faces of the reference mesh A (binary PLY format if the extension is .ply).
    -f,--faceCenterDistance               approximates the minimal distance by using the euclidean distance of the face centers (instead using the minimal distance given by projection).
    -s,--squaredDistance                  computes squared distance.
    -n,--saveNearestPoint                 save the nearest point obtained during the computation of the minimal distance (point of B).
    --maxScaleDistance FLOAT=0.1          set the default max value use to display the distance
+   -g,--cellGroupSize FLOAT:NONNEGATIVE=0
+                                         set the size of grouping digital space used to speed up computation (0: a single cell). By default it is computed from the face density and the edge lengths of the indexed mesh, not lower than the search distance and within the memory budget.
+   --searchDistance FLOAT:NONNEGATIVE=0  minimal automatic cell size of the face grid (--cellGroupSize): the faces of B closer than this distance are always found (0: the cell size only depends on the indexed mesh).
+   --memoryBudget FLOAT:POSITIVE=512     memory budget (in MB) of the automatic cell size of the face grid (--cellGroupSize).
    --exportDistanceEstimationType        Export as face color the type of distance estimation used for each face (blue for projection, green for edge projection and whitefor euclidean distance.)
+   --threads UINT=0                      number of threads used to process the faces of A (0: default number of threads).
+   -e,--exactDistance                    computes the exact distance to the faces of B (closest point on the triangles of B) by using a bounding volume hierarchy instead of the face grouping (--cellGroupSize is not used).
+   --symmetric                           computes the distances in both directions (A to B and B to A) in one run and displays the symmetric Hausdorff distance with the mean, RMS, maximum and percentiles of the distances of each direction (the output files only contain the distances of the faces of A).
+   --hausdorffOnly                       only computes the Hausdorff distance (from A to B, or symmetric with --symmetric) with exact distances and early exit: the search of a face stops as soon as it cannot increase the current maximum (no output file is written).
+   --percentiles FLOAT:FLOAT in [0 - 100] ...
+                                         percentiles of the distances displayed with their mean, RMS and maximum (in each direction with --symmetric).
+   --samples UINT=0                      number of points sampled on the surface of A (and of B with --symmetric) with a density proportional to the area (0: the face barycenters are used). The distance of a face is the maximal distance of its samples (-1 for the faces without sample) and the statistics use all the samples.
+   --seed UINT=0                         seed of the surface sampling (--samples).
+   --signed                              computes signed distances (negative for the faces of A inside B) with a fast winding number approximation on the hierarchy of B. The output mesh uses a diverging color scale in [-maxScaleDistance, maxScaleDistance] and the faces without sample (--samples) have a nan distance.
+   --candidates TEXT:FILE ... Excludes: --inputComp
+                                         compares the reference mesh A to several candidate meshes (instead of B): the index of A is built once and the candidates are read and processed in parallel (one work queue for the faces of several candidates). The distances from the faces of each candidate to A are exported in outputDir/candidateName.dat and the statistics of all the candidates in a summary table (--output, by default outputDir/summary.dat).
+   --outputFormat TEXT:{dat,bin,npy}=dat
+                                         format of the distance files: dat (text), bin (rows of 32 bit floats with the columns of the dat format) or npy (same array with a NumPy header).
+   --outputDir TEXT:DIR=.                output directory of the distance files of the candidates (--candidates).
 
 
  
@@ -60,6 +79,10 @@
  @code
  computeMeshDistances ../Samples/fandisk.off -c ../Samples/box.off -o distances.dat -m res.off --maxScaleDistance 0.7 -n
  meshViewer res.off
+ computeMeshDistances ../Samples/fandisk.off -c ../Samples/box.off --symmetric -e --percentiles 50 99
+ computeMeshDistances ../Samples/fandisk.off -c ../Samples/box.off --symmetric -e --samples 100000 --seed 1
+ computeMeshDistances ../Samples/fandisk.off -c ../Samples/sphere.off -o distances.dat -m res.off --signed -e
+ computeMeshDistances ../Samples/fandisk.off --candidates scan1.off scan2.off scan3.off -e --outputDir results
 
  @endcode
 
@@ -76,6 +99,8 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <memory>
+#include <atomic>
 
 #include "DGtal/base/Common.h"
 #include "DGtal/helpers/StdDefs.h"
@@ -83,13 +108,19 @@
 #include "DGtal/io/writers/MeshWriter.h"
 #include "DGtal/io/colormaps/GradientColorMap.h"
 #include "DGtal/io/colormaps/HueShadeColorMap.h"
-#include "DGtal/images/ImageContainerBySTLVector.h"
 #include "CLI11.hpp"
 
 #include "DGtal/shapes/Mesh.h"
 #include "DGtal/math/linalg/SimpleMatrix.h"
 #include "DGtal/kernel/BasicPointFunctors.h"
 
+#include "MeshFaceBVH.h"
+#include "QuantileSketch.h"
+#include "PointSetWriter.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace DGtal;
 
@@ -97,51 +128,223 @@ using namespace DGtal;
 static const double approxSamePlane = 0.1;
 
 
+/**
+ * Grid grouping the faces of a mesh from their barycenter in cubic
+ * cells of size cellSize. The face indices are stored contiguously by
+ * cell (compressed rows built by a two pass counting sort). When the
+ * bounding box is sparsely occupied, only the non empty cells are
+ * stored and are retrieved with an open addressing hash table. If
+ * cellSize is 0, all the faces are in a single cell. The cell size is
+ * increased if needed so that the grid has at most maxExtent cells
+ * along each axis (the linear cell keys fit in 64 bits).
+ */
 struct NeighborhoodMeshFace{
-    typedef ImageContainerBySTLVector<Z3i::Domain, std::vector<unsigned int>> FaceMap;
-    unsigned int myCellSize;
-    DGtal::Mesh<Z3i::RealPoint> myMesh;
-    FaceMap myMap;
-    NeighborhoodMeshFace(unsigned int cellSize,
-                         DGtal::Mesh<Z3i::RealPoint> aMesh): myMesh(aMesh),
-                         myCellSize(cellSize),
-                         myMap(FaceMap(Z3i::Domain())){
+    NeighborhoodMeshFace(double cellSize,
+                         const DGtal::Mesh<Z3i::RealPoint> &aMesh): myCellSize(clampedCellSize(aMesh, cellSize)),
+                         myIsSparse(false), myHashMask(0){
+        const unsigned int nbFaces = static_cast<unsigned int>(aMesh.nbFaces());
+        std::vector<DGtal::uint64_t> faceCells (nbFaces, 0);
+        for (unsigned int k = 0; k < 3; k++){
+            myLower[k] = 0;
+            myExtent[k] = 1;
+        }
+        if (myCellSize != cellSize){
+            trace.warning() << "NeighborhoodMeshFace cell size " << cellSize << " increased to " << myCellSize
+                            << " (at most " << maxExtent << " cells along an axis)." << std::endl;
+        }
+        if (myCellSize > 0 && nbFaces != 0){
+            auto bb = aMesh.getBoundingBox();
+            for (unsigned int k = 0; k < 3; k++){
+                myLower[k] = static_cast<DGtal::int64_t>(std::floor(bb.first[k]/myCellSize));
+                myExtent[k] = static_cast<DGtal::int64_t>(std::floor(bb.second[k]/myCellSize)) - myLower[k] + 1;
+            }
+            for (unsigned int i = 0; i < nbFaces; i++){
+                auto b = aMesh.getFaceBarycenter(i);
+                DGtal::int64_t c[3];
+                for (unsigned int k = 0; k < 3; k++){
+                    c[k] = std::max(DGtal::int64_t(0), std::min(myExtent[k] - 1,
+                           static_cast<DGtal::int64_t>(std::floor(b[k]/myCellSize)) - myLower[k]));
+                }
+                faceCells[i] = cellKey(c[0], c[1], c[2]);
+            }
+        }
+        const double nbCells = static_cast<double>(myExtent[0])*myExtent[1]*myExtent[2];
+        myIsSparse = isSparse(nbCells, nbFaces);
+        std::vector<unsigned int> slots (nbFaces);
+        unsigned int nbSlots;
+        if (!myIsSparse){
+            nbSlots = static_cast<unsigned int>(nbCells);
+            for (unsigned int i = 0; i < nbFaces; i++){
+                slots[i] = static_cast<unsigned int>(faceCells[i]);
+            }
+        }else{
+            // hash table of the non empty cells
+            std::vector<DGtal::uint64_t> keys (faceCells);
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            nbSlots = static_cast<unsigned int>(keys.size());
+            std::size_t capacity = 16;
+            while (capacity < 2*keys.size()) capacity *= 2;
+            myHashMask = capacity - 1;
+            myHashKeys.assign(capacity, emptyKey);
+            myHashSlots.assign(capacity, 0);
+            for (unsigned int j = 0; j < nbSlots; j++){
+                std::size_t h = hash(keys[j]);
+                while (myHashKeys[h] != emptyKey) h = (h + 1) & myHashMask;
+                myHashKeys[h] = keys[j];
+                myHashSlots[h] = j;
+            }
+            for (unsigned int i = 0; i < nbFaces; i++){
+                slots[i] = findSlot(faceCells[i]);
+            }
+        }
+        // counting sort of the faces by cell
+        myOffsets.assign(static_cast<std::size_t>(nbSlots) + 1, 0);
+        for (unsigned int i = 0; i < nbFaces; i++){
+            myOffsets[slots[i] + 1]++;
+        }
+        for (unsigned int j = 0; j < nbSlots; j++){
+            myOffsets[j + 1] += myOffsets[j];
+        }
+        myFaces.resize(nbFaces);
+        std::vector<unsigned int> pos (myOffsets.begin(), myOffsets.end() - 1);
+        for (unsigned int i = 0; i < nbFaces; i++){
+            myFaces[pos[slots[i]]++] = i;
+        }
+
+        trace.info() << "NeighborhoodMeshFace size of digitized domain [" << myLower[0]
+                             << " " << myLower[1]
+                             << " " << myLower[2]
+                             << "] [ " << myLower[0] + myExtent[0] - 1
+                             << " " << myLower[1] + myExtent[1] - 1
+                             << " " << myLower[2] + myExtent[2] - 1 << "] "
+                             << (myIsSparse ? "sparse" : "dense") << " grid with "
+                             << nbSlots << " stored cells" << std::endl;
+    }
+
+    /**
+     * Applies a functor on the index of each face in the cell of p and in
+     * its 26 neighboring cells.
+     */
+    template <typename TFunctor>
+    void forEachNeighborFace(const Z3i::RealPoint &p, TFunctor aFunctor) const {
+        DGtal::int64_t c[3];
+        for (unsigned int k = 0; k < 3; k++){
+            c[k] = myCellSize > 0 ? static_cast<DGtal::int64_t>(std::floor(p[k]/myCellSize)) - myLower[k] : 0;
+        }
+        for(DGtal::int64_t i = c[0]-1; i <= c[0]+1; i++)
+            for(DGtal::int64_t j = c[1]-1; j <= c[1]+1; j++)
+                for(DGtal::int64_t k = c[2]-1; k <= c[2]+1; k++){
+                    if (i < 0 || j < 0 || k < 0 ||
+                        i >= myExtent[0] || j >= myExtent[1] || k >= myExtent[2]){
+                        continue;
+                    }
+                    const DGtal::uint64_t key = cellKey(i, j, k);
+                    const unsigned int slot = myIsSparse ? findSlot(key) : static_cast<unsigned int>(key);
+                    if (slot == noSlot) continue;
+                    for (unsigned int f = myOffsets[slot]; f < myOffsets[slot + 1]; f++){
+                        aFunctor(myFaces[f]);
+                    }
+                }
+    }
+
+    /**
+     * @return the cell size (at least aCellSize) giving at most maxExtent
+     * cells along each axis of the bounding box of the mesh.
+     */
+    static double clampedCellSize(const DGtal::Mesh<Z3i::RealPoint> &aMesh, double aCellSize){
+        if (aCellSize <= 0 || aMesh.nbFaces() == 0) return aCellSize;
         auto bb = aMesh.getBoundingBox();
-        myMap =  FaceMap(FaceMap::Domain(bb.first/myCellSize-Z3i::Point(1,1,1), bb.second/myCellSize+Z3i::Point(1,1,1)));
-
-        trace.info() << "NeighborhoodMeshFace size of digitized domain [" << myMap.domain().lowerBound()[0]
-                             << " " << myMap.domain().lowerBound()[1]
-                             << " " << myMap.domain().lowerBound()[2]
-                             << "] [ " << myMap.domain().upperBound()[0]
-                             << " " << myMap.domain().upperBound()[1]
-                             << " " << myMap.domain().upperBound()[2] << "]" << std::endl;
-
-        for (unsigned int i = 0; i< myMesh.nbFaces(); i++){
-            auto b = myMesh.getFaceBarycenter(i);
-            auto p = Z3i::Point((int)floor(b[0]/myCellSize),(int)floor(b[1]/myCellSize),(int)floor(b[2]/myCellSize));
-            std::vector<unsigned int> v = myMap(p);
-            v.push_back(i);
-            myMap.setValue(p, v);
+        double cellSize = aCellSize;
+        for (unsigned int k = 0; k < 3; k++){
+            while (std::floor(bb.second[k]/cellSize) - std::floor(bb.first[k]/cellSize) + 1.0 > maxExtent){
+                cellSize *= 2.0;
+            }
         }
+        return cellSize;
+    }
+
+    /**
+     * @return true if a grid of nbCells cells for nbFaces faces only stores its non empty cells.
+     */
+    static bool isSparse(double nbCells, std::size_t nbFaces){
+        return nbCells > 4.0*nbFaces + 1024.0;
     }
-    std::vector<unsigned int> faceNeighboring(const Z3i::RealPoint &p){
-        std::vector<unsigned int> res;
-        auto pp = Z3i::Point((int)floor(p[0]/myCellSize),
-                             (int)floor(p[1]/myCellSize),
-                             (int)floor(p[2]/myCellSize));
-        std::vector<Z3i::Point> lVois;
-        for(int i = -1; i < 2; i++)
-            for(int j = -1; j < 2; j++)
-                for(int k = -1; k < 2; k++)
-                    lVois.push_back(pp+Z3i::Point(i,j,k));
-        for (auto pv: lVois){
-            if (myMap.domain().isInside(pv)){
-                auto v = myMap(pv);
-                res.insert(res.begin(), v.begin(), v.end());
+
+    /**
+     * Estimates the memory (in bytes) of the grid of a mesh before building
+     * it, including the temporary arrays of the construction.
+     *
+     * @param aMesh the mesh.
+     * @param cellSize the size of the cells.
+     * @param anArea the area of the mesh (to estimate the number of non empty cells).
+     */
+    static double expectedMemory(const DGtal::Mesh<Z3i::RealPoint> &aMesh, double aCellSize, double anArea){
+        const double nbFaces = static_cast<double>(aMesh.nbFaces());
+        const double cellSize = clampedCellSize(aMesh, aCellSize);
+        double nbCells = 1.0;
+        if (cellSize > 0 && aMesh.nbFaces() != 0){
+            auto bb = aMesh.getBoundingBox();
+            for (unsigned int k = 0; k < 3; k++){
+                nbCells *= std::floor(bb.second[k]/cellSize) - std::floor(bb.first[k]/cellSize) + 1.0;
             }
         }
-        return res;
+        // face cells, slots and face indices
+        const double facesMemory = nbFaces*(sizeof(DGtal::uint64_t) + 2*sizeof(unsigned int));
+        if (!isSparse(nbCells, aMesh.nbFaces())){
+            return facesMemory + 2*(nbCells + 1)*sizeof(unsigned int);
+        }
+        // the non empty cells are about the cells crossed by the surface.
+        double nbOccupied = std::min({nbFaces, nbCells, 2.0*anArea/(cellSize*cellSize) + 1.0});
+        double capacity = 16;
+        while (capacity < 2*nbOccupied) capacity *= 2;
+        return facesMemory + nbFaces*sizeof(DGtal::uint64_t) + 2*(nbOccupied + 1)*sizeof(unsigned int)
+               + capacity*(sizeof(DGtal::uint64_t) + sizeof(unsigned int));
+    }
+
+    /**
+     * Estimates the mean number of faces visited by a query close to the
+     * surface: the 3x3x3 cells around the query contain about (3 cellSize)^2
+     * of surface.
+     */
+    static double expectedCandidates(std::size_t nbFaces, double cellSize, double anArea){
+        if (cellSize <= 0 || anArea <= 0) return static_cast<double>(nbFaces);
+        return std::min(static_cast<double>(nbFaces), 9.0*cellSize*cellSize*nbFaces/anArea);
+    }
+
+private:
+    static constexpr DGtal::uint64_t emptyKey = std::numeric_limits<DGtal::uint64_t>::max();
+    static constexpr unsigned int noSlot = std::numeric_limits<unsigned int>::max();
+    // maximal number of cells along an axis (2^21: the keys are lower than 2^63).
+    static constexpr double maxExtent = 2097152.0;
+
+    DGtal::uint64_t cellKey(DGtal::int64_t i, DGtal::int64_t j, DGtal::int64_t k) const {
+        return static_cast<DGtal::uint64_t>(i + myExtent[0]*(j + myExtent[1]*k));
+    }
+
+    std::size_t hash(DGtal::uint64_t aKey) const {
+        return static_cast<std::size_t>((aKey*0x9E3779B97F4A7C15ULL) >> 17) & myHashMask;
+    }
+
+    unsigned int findSlot(DGtal::uint64_t aKey) const {
+        std::size_t h = hash(aKey);
+        while (myHashKeys[h] != emptyKey){
+            if (myHashKeys[h] == aKey) return myHashSlots[h];
+            h = (h + 1) & myHashMask;
+        }
+        return noSlot;
     }
+
+    double myCellSize;
+    bool myIsSparse;
+    DGtal::int64_t myLower[3];
+    DGtal::int64_t myExtent[3];
+    // faces of the cell (or of the non empty cell) j: myFaces[myOffsets[j]] ... myFaces[myOffsets[j+1]-1]
+    std::vector<unsigned int> myOffsets;
+    std::vector<unsigned int> myFaces;
+    std::vector<DGtal::uint64_t> myHashKeys;
+    std::vector<unsigned int> myHashSlots;
+    std::size_t myHashMask;
 };
 
 template <typename TPoint>
@@ -218,6 +421,737 @@ lineProject(const TPoint & ptA, const TPoint &ptB, TPoint &p ){
 
 typedef typename Z3i::RealPoint RPoint;
 
+enum ProjType {INSIDE, EDGE, CENTER};
+
+/**
+ * Minimal distance of a point of A to the mesh B.
+ */
+struct FaceDistance
+{
+  double distance;
+  RPoint nearest;
+  ProjType projType;
+  // false if no face of B was considered.
+  bool found;
+};
+
+
+/**
+ * Computes the minimal distance from a point of A to the faces of B
+ * which are in its neighborhood (by using face projection, edge
+ * projection or center point).
+ */
+static
+FaceDistance
+neighborhoodFaceDistance(const NeighborhoodMeshFace &neighorFaces,
+                         const DGtal::Mesh<Z3i::RealPoint> &theMeshComp,
+                         const RPoint &cA, bool useFaceCenterDistance)
+{
+  FaceDistance res {std::numeric_limits<double>::max(), cA, INSIDE, false};
+  double &distanceMin = res.distance;
+  // compute the minimal distance of the point of A to one face of point B.
+  neighorFaces.forEachNeighborFace(cA, [&](unsigned int faceIndex){
+    res.found = true;
+    // project center (cA) of a face of A into faces of B.
+    const DGtal::Mesh<Z3i::RealPoint>::MeshFace &aFaceB = theMeshComp.getFace(faceIndex);
+    RPoint pB0 = theMeshComp.getVertex(aFaceB.at(0));
+    RPoint pB1 = theMeshComp.getVertex(aFaceB.at(1));
+    RPoint pB2 = theMeshComp.getVertex(aFaceB.at(2));
+    RPoint cB =  theMeshComp.getFaceBarycenter(faceIndex);
+
+    if (useFaceCenterDistance){
+      double distance = (cB-cA).norm();
+      if (distance < distanceMin){
+        distanceMin = distance;
+        res.nearest = cB;
+      }
+      return;
+    }
+
+    RPoint normal = ((pB0-pB1).crossProduct(pB2 - pB1));
+    RPoint proj = getProjectedPoint(normal, cB, cA);
+    double distance = (proj-cA).norm();
+
+    if(!isInsideFace(theMeshComp, aFaceB, proj)){
+      // if the projection is outside the face, we approximate the distance with the projection on the face edges
+      RPoint p = cA;
+      bool lineProjOK1 = lineProject(pB0, pB1, p);
+      if(lineProjOK1 && distanceMin > (p-cA).norm()){
+        distanceMin = (p-cA).norm();
+        res.projType = EDGE;
+        res.nearest = p;
+      }
+      p= cA;
+      bool lineProjOK2 = lineProject(pB1, pB2, p);
+      if(lineProjOK2 && distanceMin > (p-cA).norm()){
+        distanceMin = (p-cA).norm();
+        res.projType = EDGE;
+        res.nearest = p;
+      }
+      p= cA;
+      bool lineProjOK3 = lineProject(pB2, pB0, p);
+      if(lineProjOK3 && distanceMin > (p-cA).norm()){
+        distanceMin = (p-cA).norm();
+        res.projType = EDGE;
+        res.nearest = p;
+      }
+      if (!lineProjOK1 && ! lineProjOK2 && ! lineProjOK3 && (cB - cA).norm() < distanceMin){
+        //if the projection is outside the face, we approximate the distance with the center of face B
+        distanceMin = (cB - cA).norm();
+        res.projType = CENTER;
+        res.nearest = cB;
+      }
+
+    }else{
+      if (distance < distanceMin){
+        res.projType = INSIDE;
+        distanceMin = distance;
+        res.nearest = proj;
+      }
+    }
+  });
+  return res;
+}
+
+
+/**
+ * Computes the exact minimal distance from a point of A to the mesh B.
+ */
+static
+FaceDistance
+exactFaceDistance(const MeshFaceBVH &bvh, const RPoint &cA)
+{
+  MeshFaceBVH::Result r = bvh.closest(cA);
+  return {r.distance, r.nearest, r.region == TRIANGLE_INSIDE ? INSIDE : EDGE,
+          bvh.nbTriangles() != 0};
+}
+
+
+
+/**
+ * Chooses the cell size of the face grid of a mesh and displays its
+ * expected memory and number of candidate faces per query. The automatic
+ * size gives about targetCandidates faces in the 27 cells of a query from
+ * the face density (area per face) and is not lower than the median edge
+ * length (so that the neighboring faces of a point are in its neighboring
+ * cells) nor than minCellSize (the searched distance). It is then
+ * increased until the grid fits in the memory budget.
+ *
+ * @param aMesh the mesh of the grid.
+ * @param aCellSize the cell size (used as is if isAutomatic is false).
+ * @param isAutomatic if true the cell size is computed.
+ * @param minCellSize the minimal automatic cell size.
+ * @param aMemoryBudget the memory budget in MB.
+ * @return the cell size.
+ */
+static
+double
+tuneGridCellSize(const DGtal::Mesh<Z3i::RealPoint> &aMesh, double aCellSize, bool isAutomatic,
+                 double minCellSize, double aMemoryBudget)
+{
+  static const double targetCandidates = 32.0;
+  const std::size_t nbFaces = aMesh.nbFaces();
+  if (nbFaces == 0) return aCellSize;
+  double area = 0.0;
+  std::vector<double> edges;
+  // the edge lengths are sampled on at most 100000 faces.
+  const std::size_t step = std::max(std::size_t(1), nbFaces/100000);
+  for (std::size_t f = 0; f < nbFaces; f++){
+    const DGtal::Mesh<Z3i::RealPoint>::MeshFace &aFace = aMesh.getFace(f);
+    const Z3i::RealPoint &a = aMesh.getVertex(aFace[0]);
+    for (unsigned int k = 1; k + 1 < aFace.size(); k++){
+      area += 0.5*((aMesh.getVertex(aFace[k]) - a).crossProduct(aMesh.getVertex(aFace[k+1]) - a)).norm();
+    }
+    if (f % step == 0){
+      for (unsigned int k = 0; k < aFace.size(); k++){
+        edges.push_back((aMesh.getVertex(aFace[(k+1) % aFace.size()]) - aMesh.getVertex(aFace[k])).norm());
+      }
+    }
+  }
+  std::nth_element(edges.begin(), edges.begin() + edges.size()/2, edges.end());
+  const double medianEdge = edges[edges.size()/2];
+  auto bb = aMesh.getBoundingBox();
+  const Z3i::RealPoint size = bb.second - bb.first;
+  double cellSize = aCellSize;
+  if (isAutomatic){
+    cellSize = std::max({std::sqrt(targetCandidates*area/(9.0*nbFaces)), medianEdge, minCellSize});
+    const double diagonal = size.norm();
+    while (NeighborhoodMeshFace::expectedMemory(aMesh, cellSize, area) > aMemoryBudget*1024.0*1024.0 &&
+           cellSize < diagonal){
+      cellSize *= 1.25;
+    }
+    trace.info() << "automatic cell size: " << cellSize << " (median edge length " << medianEdge
+                 << ", bounding box volume " << size[0]*size[1]*size[2] << ", area " << area << ")" << std::endl;
+  }
+  const double memory = NeighborhoodMeshFace::expectedMemory(aMesh, cellSize, area);
+  trace.info() << "face grid: expected memory " << memory/(1024.0*1024.0) << " MB, about "
+               << NeighborhoodMeshFace::expectedCandidates(nbFaces, cellSize, area)
+               << " candidate faces per query" << std::endl;
+  if (memory > aMemoryBudget*1024.0*1024.0){
+    trace.warning() << "the face grid exceeds the memory budget (" << aMemoryBudget << " MB)." << std::endl;
+  }
+  return cellSize;
+}
+
+
+
+/**
+ * Spatial index of a mesh giving the minimal distance of a point to its
+ * faces: face grid (approximated distances) or face hierarchy (exact
+ * distances). The hierarchy is also built when the inside/outside test
+ * of the signed distances is needed.
+ */
+class MeshDistanceIndex
+{
+public:
+  typedef DGtal::Mesh<Z3i::RealPoint> Mesh;
+
+  /**
+   * Builds the index.
+   *
+   * @param aMesh the indexed mesh.
+   * @param aName the name of the mesh displayed in the messages.
+   * @param exactDistance if true the exact distances are computed with the hierarchy.
+   * @param withHierarchy if true the hierarchy is also built for the approximated distances.
+   * @param aCellSize the size of the cells of the face grid.
+   * @param useFaceCenterDistance if true the grid distances are the distances of the face centers.
+   */
+  MeshDistanceIndex(const Mesh &aMesh, const std::string &aName, bool exactDistance,
+                    bool withHierarchy, double aCellSize, bool useFaceCenterDistance):
+    myMesh(aMesh), myUseFaceCenterDistance(useFaceCenterDistance)
+  {
+    if (exactDistance || withHierarchy){
+      trace.info()<< "Constructing " << aName << " mesh hierarchy ...";
+      myHierarchy.reset(new MeshFaceBVH(aMesh));
+      trace.info()<< "[done] (" << myHierarchy->nbNodes() << " nodes)" << std::endl;
+    }
+    if (!exactDistance){
+      trace.info()<< "Constructing " << aName << " mesh map ...";
+      myGrid.reset(new NeighborhoodMeshFace(aCellSize, aMesh));
+      trace.info()<< "[done]";
+    }
+  }
+
+  /**
+   * @return the minimal distance of a point to the faces of the mesh.
+   */
+  FaceDistance distance(const RPoint &p) const
+  {
+    return myGrid ? neighborhoodFaceDistance(*myGrid, myMesh, p, myUseFaceCenterDistance) :
+                    exactFaceDistance(*myHierarchy, p);
+  }
+
+  /**
+   * @return true if the point is inside the mesh (the winding number is
+   * used in absolute value to accept meshes with inward oriented faces).
+   */
+  bool isInside(const RPoint &p) const
+  {
+    return std::abs(myHierarchy->windingNumber(p)) > 0.5;
+  }
+
+  /**
+   * @return the face hierarchy (null if it was not built).
+   */
+  const MeshFaceBVH * hierarchy() const
+  {
+    return myHierarchy.get();
+  }
+
+private:
+  const Mesh &myMesh;
+  bool myUseFaceCenterDistance;
+  std::unique_ptr<NeighborhoodMeshFace> myGrid;
+  std::unique_ptr<MeshFaceBVH> myHierarchy;
+};
+
+
+
+/**
+ * Random sampling of the surface of a mesh with a density proportional
+ * to the area. The number of samples of each face is given by a
+ * systematic sampling of the cumulated face areas and the samples of a
+ * face are uniformly distributed on its (fan) triangles, with a random
+ * generator seeded from the seed and the face index (the samples do not
+ * depend on the number of threads).
+ */
+class MeshSurfaceSampler
+{
+public:
+  typedef DGtal::Mesh<Z3i::RealPoint> Mesh;
+
+  MeshSurfaceSampler(const Mesh &aMesh, unsigned long long aNbSamples, unsigned int aSeed):
+    myMesh(aMesh), mySeed(aSeed)
+  {
+    const unsigned int nbFaces = static_cast<unsigned int>(aMesh.nbFaces());
+    std::vector<double> cumulatedArea (nbFaces + 1, 0.0);
+    for (unsigned int f = 0; f < nbFaces; f++){
+      cumulatedArea[f + 1] = cumulatedArea[f] + faceArea(f);
+    }
+    myOffsets.assign(nbFaces + 1, 0);
+    if (nbFaces == 0 || cumulatedArea[nbFaces] <= 0.0) return;
+    DGtal::uint64_t state = mySeed;
+    const double start = uniform(state);
+    const double density = aNbSamples/cumulatedArea[nbFaces];
+    for (unsigned int f = 1; f < nbFaces; f++){
+      myOffsets[f] = static_cast<unsigned long long>(std::floor(cumulatedArea[f]*density + start));
+    }
+    myOffsets[nbFaces] = aNbSamples;
+  }
+
+  /**
+   * @return the number of samples of the face f.
+   */
+  unsigned long long nbSamples(unsigned int f) const
+  {
+    return myOffsets[f + 1] - myOffsets[f];
+  }
+
+  /**
+   * Computes the samples of the face f.
+   *
+   * @param f the face index.
+   * @param[out] samples the sample points (previous content removed).
+   */
+  void faceSamples(unsigned int f, std::vector<Z3i::RealPoint> &samples) const
+  {
+    samples.clear();
+    const unsigned long long n = nbSamples(f);
+    if (n == 0) return;
+    const Mesh::MeshFace &aFace = myMesh.getFace(f);
+    const double area = faceArea(f);
+    DGtal::uint64_t state = mySeed ^ ((static_cast<DGtal::uint64_t>(f) + 1)*0xD1B54A32D192ED03ULL);
+    for (unsigned long long i = 0; i < n; i++){
+      // triangle of the fan selected according to its area
+      double r = uniform(state)*area;
+      unsigned int k = 1;
+      for (; k + 2 < aFace.size(); k++){
+        const double a = triangleArea(aFace[0], aFace[k], aFace[k+1]);
+        if (r < a) break;
+        r -= a;
+      }
+      const Z3i::RealPoint &a = myMesh.getVertex(aFace[0]);
+      const Z3i::RealPoint &b = myMesh.getVertex(aFace[k]);
+      const Z3i::RealPoint &c = myMesh.getVertex(aFace[k+1]);
+      const double s = std::sqrt(uniform(state));
+      const double t = uniform(state);
+      samples.push_back(a + (b - a)*(s*(1.0 - t)) + (c - a)*(s*t));
+    }
+  }
+
+private:
+  double triangleArea(unsigned int i, unsigned int j, unsigned int k) const
+  {
+    const Z3i::RealPoint &a = myMesh.getVertex(i);
+    return 0.5*((myMesh.getVertex(j) - a).crossProduct(myMesh.getVertex(k) - a)).norm();
+  }
+
+  double faceArea(unsigned int f) const
+  {
+    const Mesh::MeshFace &aFace = myMesh.getFace(f);
+    double area = 0.0;
+    for (unsigned int k = 1; k + 1 < aFace.size(); k++){
+      area += triangleArea(aFace[0], aFace[k], aFace[k+1]);
+    }
+    return area;
+  }
+
+  /// uniform value in [0, 1) from a splitmix64 generator.
+  static double uniform(DGtal::uint64_t &state)
+  {
+    DGtal::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return (z >> 11)*(1.0/9007199254740992.0);
+  }
+
+  const Mesh &myMesh;
+  DGtal::uint64_t mySeed;
+  // samples of the face f: [myOffsets[f], myOffsets[f+1])
+  std::vector<unsigned long long> myOffsets;
+};
+
+
+
+/**
+ * Displays the statistics of the distances of one direction.
+ */
+static
+void
+displayStatistics(const DistanceStatistics &stats, const std::vector<double> &percentiles)
+{
+  trace.info() << stats.count << " points, max: " << stats.maximum << ", mean: " << stats.mean()
+               << ", RMS: " << stats.rms();
+  for (double p: percentiles){
+    trace.info() << ", p" << p << ": " << stats.sketch.quantile(p/100.0);
+  }
+  trace.info() << std::endl;
+}
+
+
+
+/**
+ * Computes the distance of a face: the maximal distance to the other
+ * mesh of its points (its barycenter or its samples).
+ *
+ * @param aMesh the mesh of the face.
+ * @param f the face index.
+ * @param sampler the surface sampler (null to use the barycenter).
+ * @param pointDistance the functor giving the distance of a point.
+ * @param[out] points the points of the face.
+ * @param[out] facePoint the point giving the distance of the face.
+ * @param[in,out] stats the statistics updated with the distance of each point.
+ * @return the distance of the face (found is false if no point has a distance).
+ */
+template<typename TPointDistance>
+static
+FaceDistance
+maxFaceDistance(const DGtal::Mesh<Z3i::RealPoint> &aMesh, unsigned int f,
+                const MeshSurfaceSampler *sampler, const TPointDistance &pointDistance,
+                std::vector<RPoint> &points, RPoint &facePoint, DistanceStatistics &stats)
+{
+  const RPoint center = aMesh.getFaceBarycenter(f);
+  points.clear();
+  if (sampler != nullptr){
+    sampler->faceSamples(f, points);
+  }else{
+    points.push_back(center);
+  }
+  FaceDistance fd {-1.0, center, INSIDE, false};
+  facePoint = center;
+  for (const RPoint &p: points){
+    FaceDistance pd = pointDistance(p);
+    if (pd.found){
+      stats.add(pd.distance);
+      if (!fd.found || pd.distance > fd.distance){
+        fd = pd;
+        facePoint = p;
+      }
+    }
+  }
+  return fd;
+}
+
+
+
+/**
+ * Parameters of the distance computation shared by the main mode and the
+ * candidates mode.
+ */
+struct DistanceParameters
+{
+  bool saveNearestPoint;
+  bool signedDistance;
+  unsigned long long nbSamples;
+  unsigned int seed;
+  // distance of the faces without neighbor faces in the other mesh.
+  double notFoundDistance;
+  std::vector<double> percentiles;
+  // format of the distance files: dat (text), bin or npy.
+  std::string outputFormat;
+};
+
+
+
+/**
+ * Exports the distances of the faces of a mesh in binary: one row per
+ * face (face center, distance and optionally the nearest point) of 32
+ * bit floats in the byte order of the host, written with a single write.
+ * With the npy format, the array is preceded by the NumPy header (format
+ * version 1.0) giving its type and shape. The faces without sample have
+ * a nan distance.
+ */
+static
+void
+exportBinaryDistances(const std::string &fileName, const DGtal::Mesh<Z3i::RealPoint> &aMesh,
+                      const std::vector<double> &distances, const std::vector<RPoint> &nearestPoints,
+                      const DistanceParameters &params, bool npy)
+{
+  const std::size_t nbFaces = aMesh.nbFaces();
+  const std::size_t nbColumns = params.saveNearestPoint ? 7 : 4;
+  std::vector<float> values (nbFaces*nbColumns);
+#pragma omp parallel for schedule(static)
+  for (long long i = 0; i < static_cast<long long>(nbFaces); i++){
+    const RPoint center = aMesh.getFaceBarycenter(i);
+    float *row = &values[i*nbColumns];
+    row[0] = static_cast<float>(center[0]);
+    row[1] = static_cast<float>(center[1]);
+    row[2] = static_cast<float>(center[2]);
+    row[3] = static_cast<float>(distances[i]);
+    if (params.saveNearestPoint){
+      row[4] = static_cast<float>(nearestPoints[i][0]);
+      row[5] = static_cast<float>(nearestPoints[i][1]);
+      row[6] = static_cast<float>(nearestPoints[i][2]);
+    }
+  }
+  std::ofstream out (fileName.c_str(), std::ofstream::out | std::ofstream::binary);
+  if (npy){
+    writeNpyHeader(out, "f4", nbFaces, nbColumns);
+  }
+  out.write(reinterpret_cast<const char*>(values.data()), values.size()*sizeof(float));
+  out.close();
+}
+
+
+
+/**
+ * Exports a mesh with its face colors in the binary PLY format (vertex
+ * coordinates as 32 bit floats, faces as vertex index lists with their
+ * colors) with a single write of the data.
+ */
+static
+void
+exportBinaryPLY(const std::string &fileName, const DGtal::Mesh<Z3i::RealPoint> &aMesh)
+{
+  const std::size_t nbVertex = aMesh.nbVertex();
+  const std::size_t nbFaces = aMesh.nbFaces();
+  std::vector<char> buffer;
+  buffer.reserve(nbVertex*3*sizeof(float) + nbFaces*(1 + 4*sizeof(DGtal::int32_t) + 3));
+  auto append = [&buffer](const void *aData, std::size_t aSize){
+    const char *data = static_cast<const char*>(aData);
+    buffer.insert(buffer.end(), data, data + aSize);
+  };
+  for (std::size_t i = 0; i < nbVertex; i++){
+    const Z3i::RealPoint &p = aMesh.getVertex(i);
+    const float coords[3] = {static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2])};
+    append(coords, sizeof(coords));
+  }
+  for (std::size_t i = 0; i < nbFaces; i++){
+    const DGtal::Mesh<Z3i::RealPoint>::MeshFace &aFace = aMesh.getFace(i);
+    const unsigned char nb = static_cast<unsigned char>(aFace.size());
+    append(&nb, 1);
+    for (auto v: aFace){
+      const DGtal::int32_t index = static_cast<DGtal::int32_t>(v);
+      append(&index, sizeof(index));
+    }
+    const DGtal::Color &c = aMesh.getFaceColor(i);
+    const unsigned char rgb[3] = {c.red(), c.green(), c.blue()};
+    append(rgb, 3);
+  }
+  std::ofstream out (fileName.c_str(), std::ofstream::out | std::ofstream::binary);
+  out << "ply\n"
+      << "format " << (isLittleEndian() ? "binary_little_endian" : "binary_big_endian") << " 1.0\n"
+      << "comment exported by computeMeshDistances of the DGtalTools-contrib project\n"
+      << "element vertex " << nbVertex << "\n"
+      << "property float x\nproperty float y\nproperty float z\n"
+      << "element face " << nbFaces << "\n"
+      << "property list uchar int vertex_indices\n"
+      << "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+      << "end_header\n";
+  out.write(buffer.data(), buffer.size());
+  out.close();
+}
+
+
+
+/**
+ * Exports a mesh in OFF (text) or in binary PLY according to the file extension.
+ */
+static
+void
+exportMesh(const std::string &fileName, const DGtal::Mesh<Z3i::RealPoint> &aMesh)
+{
+  const std::string extension = fileName.substr(fileName.find_last_of(".")+1);
+  if (extension == "ply"){
+    exportBinaryPLY(fileName, aMesh);
+    return;
+  }
+  std::ofstream outMesh;
+  outMesh.open(fileName.c_str(), std::ofstream::out);
+  MeshWriter<Z3i::RealPoint>::export2OFF(outMesh, aMesh, true);
+  outMesh.close();
+}
+
+
+
+/**
+ * Exports the distances of the faces of a mesh (one line per face: face
+ * center, distance and optionally the nearest point) in text, or in
+ * binary according to the output format.
+ */
+static
+void
+exportDistances(const std::string &fileName, const std::string &programName,
+                const std::string &meshName, const std::string &compMeshName,
+                const DGtal::Mesh<Z3i::RealPoint> &aMesh, const std::vector<double> &distances,
+                const std::vector<RPoint> &nearestPoints, const DistanceParameters &params)
+{
+  if (params.outputFormat != "dat"){
+    exportBinaryDistances(fileName, aMesh, distances, nearestPoints, params, params.outputFormat == "npy");
+    return;
+  }
+  std::ofstream outDistances;
+  outDistances.open(fileName.c_str(), std::ofstream::out);
+  outDistances << "# resulting distances computed from the " << programName << " program of the DGtalTools-contrib project." << std::endl;
+  outDistances << "# minimal distance between the mesh " << meshName << " to " << compMeshName << std::endl;
+  if (params.nbSamples != 0){
+    outDistances << "# distance of a face: maximal distance of its " << params.nbSamples << " area weighted samples (seed "
+                 << params.seed << "), " << (params.signedDistance ? "nan" : "-1") << " if the face has no sample" << std::endl;
+  }
+  if (params.signedDistance){
+    outDistances << "# signed distances: negative for the faces inside " << compMeshName << std::endl;
+  }
+  outDistances << "# format: faceCenter_x faceCenter_y faceCenter_z distanceMin";
+ 
+  if (params.saveNearestPoint) {
+    outDistances << " nearestPoint_x nearestPoint_y nearestPoint_z ";
+  }
+  outDistances << std::endl;
+  for (unsigned int i=0; i< aMesh.nbFaces(); i++){
+    RPoint center = aMesh.getFaceBarycenter(i);
+    outDistances << center[0] << " " << center[1] << " " << center[2] << " ";
+    if (std::isnan(distances[i])){
+      outDistances << (params.signedDistance ? "nan" : "-1");
+    }else{
+      outDistances << distances[i];
+    }
+    if (params.saveNearestPoint)
+    {
+      outDistances << " " << nearestPoints[i][0] << " " << nearestPoints[i][1] << " " << nearestPoints[i][2];
+    }
+    outDistances<< std::endl;
+  }
+  outDistances.close();
+}
+
+
+
+/**
+ * Computes the distances from the faces of each candidate mesh to the
+ * reference mesh, whose index is built once. The candidates are processed
+ * by batches of one candidate per thread: the candidates of a batch are
+ * read in parallel, then the faces of all of them form a single work
+ * queue (so that a large candidate is not processed by a single thread),
+ * the distances of each candidate are exported in
+ * outputDir/candidateName.dat (or .bin, .npy) and the statistics of all
+ * the candidates in a summary table.
+ *
+ * @return the number of candidates which could not be read.
+ */
+static
+unsigned int
+processCandidates(const MeshDistanceIndex &refIndex, const std::string &refName,
+                  const std::vector<std::string> &candidates, const std::string &outputDir,
+                  const std::string &summaryFileName, const std::string &programName,
+                  const DistanceParameters &params)
+{
+  typedef DGtal::Mesh<Z3i::RealPoint> Mesh;
+  const long long nbCandidates = static_cast<long long>(candidates.size());
+  std::vector<DistanceStatistics> stats (nbCandidates);
+  std::vector<unsigned int> nbFaces (nbCandidates, 0);
+  std::vector<unsigned int> nbInside (nbCandidates, 0);
+  std::vector<char> isRead (nbCandidates, 0);
+  unsigned int nbDone = 0;
+  unsigned int nbErrors = 0;
+  long long batchSize = 1;
+#ifdef _OPENMP
+  batchSize = omp_get_max_threads();
+#endif
+  for (long long first = 0; first < nbCandidates; first += batchSize){
+    const long long nbBatch = std::min(batchSize, nbCandidates - first);
+    std::vector<std::unique_ptr<Mesh>> meshes (nbBatch);
+    std::vector<std::unique_ptr<MeshSurfaceSampler>> samplers (nbBatch);
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:nbErrors)
+    for (long long b = 0; b < nbBatch; b++){
+      const long long c = first + b;
+      meshes[b].reset(new Mesh(true));
+      if (!MeshReader<Z3i::RealPoint>::importOFFFile(candidates[c], *meshes[b], false)){
+        nbErrors++;
+        meshes[b].reset();
+#pragma omp critical
+        trace.warning() << "can't read the candidate mesh " << candidates[c] << std::endl;
+        continue;
+      }
+      isRead[c] = 1;
+      nbFaces[c] = static_cast<unsigned int>(meshes[b]->nbFaces());
+      if (params.nbSamples != 0){
+        samplers[b].reset(new MeshSurfaceSampler(*meshes[b], params.nbSamples, params.seed));
+      }
+    }
+    // faces of the candidate b of the batch: [faceOffsets[b], faceOffsets[b+1]) in the work queue.
+    std::vector<long long> faceOffsets (nbBatch + 1, 0);
+    std::vector<std::vector<double>> distances (nbBatch);
+    std::vector<std::vector<RPoint>> nearestPoints (nbBatch);
+    for (long long b = 0; b < nbBatch; b++){
+      faceOffsets[b + 1] = faceOffsets[b] + nbFaces[first + b];
+      distances[b].resize(nbFaces[first + b]);
+      nearestPoints[b].resize(nbFaces[first + b]);
+    }
+    const long long nbFacesBatch = faceOffsets[nbBatch];
+#pragma omp parallel
+    {
+      std::vector<DistanceStatistics> localStats (nbBatch);
+      std::vector<unsigned int> localInside (nbBatch, 0);
+      std::vector<RPoint> points;
+      RPoint facePoint;
+#pragma omp for schedule(dynamic, 256)
+      for (long long i = 0; i < nbFacesBatch; i++){
+        const long long b = std::upper_bound(faceOffsets.begin(), faceOffsets.end(), i) - faceOffsets.begin() - 1;
+        const unsigned int f = static_cast<unsigned int>(i - faceOffsets[b]);
+        const Mesh &candidate = *meshes[b];
+        FaceDistance fd = maxFaceDistance(candidate, f, samplers[b].get(),
+                                          [&refIndex](const RPoint &p){ return refIndex.distance(p); },
+                                          points, facePoint, localStats[b]);
+        if (params.signedDistance && fd.found && refIndex.isInside(facePoint)){
+          fd.distance = -fd.distance;
+          localInside[b]++;
+        }
+        nearestPoints[b][f] = fd.found && params.saveNearestPoint ? fd.nearest : candidate.getFaceBarycenter(f);
+        distances[b][f] = fd.found ? fd.distance : (points.empty() ? std::numeric_limits<double>::quiet_NaN() :
+                                                                      params.notFoundDistance);
+      }
+#pragma omp critical
+      for (long long b = 0; b < nbBatch; b++){
+        stats[first + b].merge(localStats[b]);
+        nbInside[first + b] += localInside[b];
+      }
+    }
+#pragma omp parallel for schedule(dynamic, 1)
+    for (long long b = 0; b < nbBatch; b++){
+      const long long c = first + b;
+      if (!isRead[c]) continue;
+      std::string name = candidates[c].substr(candidates[c].find_last_of("/")+1);
+      name = name.substr(0, name.find_last_of("."));
+      exportDistances(outputDir + "/" + name + "." + params.outputFormat, programName, candidates[c], refName,
+                      *meshes[b], distances[b], nearestPoints[b], params);
+#pragma omp critical
+      {
+        nbDone++;
+        trace.info() << "[" << nbDone << "/" << nbCandidates << "] " << candidates[c] << ": ";
+        displayStatistics(stats[c], params.percentiles);
+      }
+    }
+  }
+
+  std::ofstream summary;
+  summary.open(summaryFileName.c_str(), std::ofstream::out);
+  summary << "# distances from the faces of the candidate meshes to the reference mesh " << refName
+          << " computed from the " << programName << " program of the DGtalTools-contrib project." << std::endl;
+  summary << "# format: candidate nbFaces nbPoints max mean RMS";
+  for (double p: params.percentiles){
+    summary << " p" << p;
+  }
+  if (params.signedDistance){
+    summary << " nbFacesInside";
+  }
+  summary << std::endl;
+  for (long long c = 0; c < nbCandidates; c++){
+    if (!isRead[c]) continue;
+    summary << candidates[c] << " " << nbFaces[c] << " " << stats[c].count << " " << stats[c].maximum
+            << " " << stats[c].mean() << " " << stats[c].rms();
+    for (double p: params.percentiles){
+      summary << " " << stats[c].sketch.quantile(p/100.0);
+    }
+    if (params.signedDistance){
+      summary << " " << nbInside[c];
+    }
+    summary << std::endl;
+  }
+  summary.close();
+  return nbErrors;
+}
+
 
 
 int
@@ -236,9 +1170,22 @@ main(int argc,char **argv)
   bool squaredDistance {false};
   bool saveNearestPoint {false};
   bool exportDistanceEstimationType {false};
+  bool exactDistance {false};
+  unsigned int nbThreads {0};
   double maxScaleDistance {0.1};
   double minScaleDistance {0.0};
-  unsigned int cellGroupSize{10};
+  double cellGroupSize {0.0};
+  double searchDistance {0.0};
+  double memoryBudget {512.0};
+  bool symmetric {false};
+  bool hausdorffOnly {false};
+  std::vector<double> percentiles {50.0, 90.0, 95.0, 99.0};
+  unsigned long long nbSamples {0};
+  bool signedDistance {false};
+  unsigned int seed {0};
+  std::vector<std::string> candidates;
+  std::string outputDir {"."};
+  std::string outputFormat {"dat"};
   std::stringstream appDescr;
   appDescr << "Computes for each face of a mesh A the minimal distance to another mesh B. For each face of A, the minimal distance to B is computed by a brut force scan and the result can be exported as a mesh where the distances are represented in color scale. The maximal value of all these distances is also given as std output.";
   appDescr <<  "Example of use (from the DGtalTools-contrib directory:"<< "\n" <<
@@ -253,172 +1200,289 @@ main(int argc,char **argv)
   app.add_option("-i,--input,1", inputMeshName, "input file name of mesh A (reference shape) given as OFF format." )
       ->required()
       ->check(CLI::ExistingFile);
-  app.add_option("--inputComp,-c,2", inputCompMeshName, "input file name of mesh B (compared shape) given as OFF format." )
-      ->required()
+  auto inputCompOpt = app.add_option("--inputComp,-c,2", inputCompMeshName, "input file name of mesh B (compared shape) given as OFF format." )
       ->check(CLI::ExistingFile);
 
-  app.add_option("--output,-o", outputFileName, "arg = file.dat : output file containing all the distances of each input mesh faces (faces of A)");
+  auto outputOpt = app.add_option("--output,-o", outputFileName, "arg = file.dat : output file containing all the distances of each input mesh faces (faces of A)");
   
-  app.add_option("--outputMesh,-m",outputMeshFileName, "arg = file.off : export the resulting distances represented with a color scale on the faces of the reference mesh A.");
+  app.add_option("--outputMesh,-m",outputMeshFileName, "arg = file.off : export the resulting distances represented with a color scale on the faces of the reference mesh A (binary PLY format if the extension is .ply).");
   
   app.add_flag("--faceCenterDistance,-f",useFaceCenterDistance, "approximates the minimal distance by using the euclidean distance of the face centers (instead using the minimal distance given by projection).");
   app.add_flag("--squaredDistance,-s", squaredDistance, "computes squared distance.");
   app.add_flag("--saveNearestPoint,-n", saveNearestPoint, "save the nearest point obtained during the computation of the minimal distance (point of B).");
   app.add_option("--maxScaleDistance", maxScaleDistance, "set the default max value use to display the distance");
-  auto cGroupOpt = app.add_option("--cellGroupSize,-g", cellGroupSize, "set the size of grouping digital space used to speed up computation (by default set to maxScaleDistance/2,5).");
+  auto cGroupOpt = app.add_option("--cellGroupSize,-g", cellGroupSize, "set the size of grouping digital space used to speed up computation"
+                                  " (0: a single cell). By default it is computed from the face density and the edge lengths of the"
+                                  " indexed mesh, not lower than the search distance and within the memory budget.")
+      ->check(CLI::NonNegativeNumber);
+  app.add_option("--searchDistance", searchDistance, "minimal automatic cell size of the face grid (--cellGroupSize):"
+                 " the faces of B closer than this distance are always found (0: the cell size only depends on the"
+                 " indexed mesh).")
+      ->check(CLI::NonNegativeNumber);
+  app.add_option("--memoryBudget", memoryBudget, "memory budget (in MB) of the automatic cell size of the face grid (--cellGroupSize).")
+      ->check(CLI::PositiveNumber);
 
   app.add_flag("--exportDistanceEstimationType", exportDistanceEstimationType, "Export as face color the type of"
                " distance estimation used for each face (blue for projection, green for edge projection and white"
                "for euclidean distance.)");
   app.add_option("--minScaleDistance",minScaleDistance, "set the default min value use to display the distance");
+  app.add_flag("--exactDistance,-e", exactDistance, "computes the exact distance to the faces of B (closest point on the triangles of B)"
+               " by using a bounding volume hierarchy instead of the face grouping (--cellGroupSize is not used).");
+  app.add_option("--threads", nbThreads, "number of threads used to process the faces of A (0: default number of threads).");
+  app.add_flag("--symmetric", symmetric, "computes the distances in both directions (A to B and B to A) in one run and displays the"
+               " symmetric Hausdorff distance with the mean, RMS, maximum and percentiles of the distances of each direction"
+               " (the output files only contain the distances of the faces of A).");
+  app.add_flag("--hausdorffOnly", hausdorffOnly, "only computes the Hausdorff distance (from A to B, or symmetric with --symmetric)"
+               " with exact distances and early exit: the search of a face stops as soon as it cannot increase the current"
+               " maximum (no output file is written).");
+  app.add_option("--percentiles", percentiles, "percentiles of the distances displayed with their mean, RMS and maximum (in each direction with --symmetric).")
+      ->check(CLI::Range(0.0, 100.0));
+  app.add_option("--samples", nbSamples, "number of points sampled on the surface of A (and of B with --symmetric) with a"
+                 " density proportional to the area (0: the face barycenters are used). The distance of a face is the"
+                 " maximal distance of its samples (-1 for the faces without sample) and the statistics use all the samples.");
+  app.add_option("--seed", seed, "seed of the surface sampling (--samples).");
+  app.add_flag("--signed", signedDistance, "computes signed distances (negative for the faces of A inside B) with a fast winding"
+               " number approximation on the hierarchy of B. The output mesh uses a diverging color scale in"
+               " [-maxScaleDistance, maxScaleDistance] and the faces without sample (--samples) have a nan distance.");
+  auto candidatesOpt = app.add_option("--candidates", candidates, "compares the reference mesh A to several candidate meshes"
+                 " (instead of B): the index of A is built once and the candidates are read and processed in parallel"
+                 " (one work queue for the faces of several candidates). The distances from the faces of each candidate"
+                 " to A are exported in outputDir/candidateName.dat and the statistics of all the candidates in a summary"
+                 " table (--output, by default outputDir/summary.dat).")
+      ->check(CLI::ExistingFile)
+      ->excludes(inputCompOpt);
+  app.add_option("--outputFormat", outputFormat, "format of the distance files: dat (text), bin (rows of 32 bit floats"
+                 " with the columns of the dat format) or npy (same array with a NumPy header).")
+      ->check(CLI::IsMember({"dat", "bin", "npy"}));
+  app.add_option("--outputDir", outputDir, "output directory of the distance files of the candidates (--candidates).")
+      ->check(CLI::ExistingDirectory);
 
   
   app.get_formatter()->column_width(40);
   CLI11_PARSE(app, argc, argv);
   // END parse command line using CLI ----------------------------------------------
+  if (inputCompOpt->count() == 0 && candidatesOpt->count() == 0){
+    trace.error() << "a compared mesh (--inputComp) or candidate meshes (--candidates) are required." << std::endl;
+    return 1;
+  }
 
-
+#ifdef _OPENMP
+  if (nbThreads != 0){
+    omp_set_num_threads(nbThreads);
+  }
+#endif
+  
   
   DGtal::Mesh<Z3i::RealPoint> theMeshRef(true);
   DGtal::Mesh<Z3i::RealPoint> theMeshComp(true);
-  DGtal::Mesh<Z3i::RealPoint> theNewMeshDistance (true);
-  DGtal::Mesh<Z3i::RealPoint> projOkMesh (true);
   
   MeshReader<Z3i::RealPoint>::importOFFFile(inputMeshName, theMeshRef, false);
-  MeshReader<Z3i::RealPoint>::importOFFFile(inputMeshName, theNewMeshDistance, false);
-  MeshReader<Z3i::RealPoint>::importOFFFile(inputCompMeshName, theMeshComp, false);
-  MeshReader<Z3i::RealPoint>::importOFFFile(inputMeshName, projOkMesh, false);
   
-    if (cGroupOpt->count() == 0){
-        cellGroupSize = maxScaleDistance / 2.5;
+  std::string name  = argv[0];
+  name = name.substr(name.find_last_of("/")+1);
+  DistanceParameters params {saveNearestPoint, signedDistance, nbSamples, seed, maxScaleDistance, percentiles,
+                             outputFormat};
+  if (candidatesOpt->count() != 0){
+    if (symmetric || hausdorffOnly){
+      trace.warning() << "options --symmetric and --hausdorffOnly ignored with --candidates." << std::endl;
     }
-  
+    if (!exactDistance){
+      cellGroupSize = tuneGridCellSize(theMeshRef, cellGroupSize, cGroupOpt->count() == 0,
+                                       searchDistance, memoryBudget);
+    }
+    MeshDistanceIndex refIndex (theMeshRef, "reference", exactDistance, signedDistance,
+                                cellGroupSize, useFaceCenterDistance);
+    const std::string summaryFileName = outputOpt->count() != 0 ? outputFileName : outputDir + "/summary.dat";
+    unsigned int nbErrors = processCandidates(refIndex, inputMeshName, candidates, outputDir,
+                                              summaryFileName, name, params);
+    trace.info() << "summary of " << candidates.size() - nbErrors << " candidates exported in "
+                 << summaryFileName << std::endl;
+    return nbErrors == 0 ? 0 : 1;
+  }
+
+  MeshReader<Z3i::RealPoint>::importOFFFile(inputCompMeshName, theMeshComp, false);
+  DGtal::Mesh<Z3i::RealPoint> theNewMeshDistance (theMeshRef);
+  DGtal::Mesh<Z3i::RealPoint> projOkMesh (theMeshRef);
   trace.info()<< "reading the input Comp mesh ok: "<< theMeshComp.nbVertex() <<  std::endl;
-  trace.info()<< "Constructing compared mesh map ...";
-  NeighborhoodMeshFace neighorFaces (cellGroupSize, theMeshComp);
-  trace.info()<< "[done]";
+  if (exactDistance && useFaceCenterDistance){
+    trace.warning() << "option --faceCenterDistance ignored with --exactDistance." << std::endl;
+  }
+  if (hausdorffOnly && signedDistance){
+    trace.warning() << "option --signed ignored with --hausdorffOnly." << std::endl;
+    signedDistance = false;
+  }
+  if (hausdorffOnly && !exactDistance){
+    trace.info() << "option --hausdorffOnly uses exact distances (--exactDistance)." << std::endl;
+    exactDistance = true;
+  }
+  // the cell size of each grid is tuned on the mesh it indexes.
+  double cellSizeComp = cellGroupSize;
+  double cellSizeRef = cellGroupSize;
+  if (!exactDistance){
+    cellSizeComp = tuneGridCellSize(theMeshComp, cellGroupSize, cGroupOpt->count() == 0,
+                                    searchDistance, memoryBudget);
+    if (symmetric){
+      cellSizeRef = tuneGridCellSize(theMeshRef, cellGroupSize, cGroupOpt->count() == 0,
+                                     searchDistance, memoryBudget);
+    }
+  }
+  // spatial indices of B (A to B distances) and of A (B to A distances in symmetric mode).
+  // the hierarchy of B is also used for the inside/outside test of --signed.
+  MeshDistanceIndex indexComp (theMeshComp, "compared", exactDistance, signedDistance,
+                               cellSizeComp, useFaceCenterDistance);
+  std::unique_ptr<MeshDistanceIndex> indexRef;
+  if (symmetric){
+    indexRef.reset(new MeshDistanceIndex(theMeshRef, "reference", exactDistance, false,
+                                         cellSizeRef, useFaceCenterDistance));
+  }
 
   
   
-  double maxOfMin = 0;
-  std::vector<double> vectFaceDistances;
-  std::vector<RPoint> vectNearestPt;
+  std::unique_ptr<MeshSurfaceSampler> samplerRef, samplerComp;
+  if (nbSamples != 0){
+    samplerRef.reset(new MeshSurfaceSampler(theMeshRef, nbSamples, seed));
+    if (symmetric){
+      samplerComp.reset(new MeshSurfaceSampler(theMeshComp, nbSamples, seed));
+    }
+  }
+  const long long nbFacesRef = static_cast<long long>(theMeshRef.nbFaces());
+  const long long nbFacesComp = symmetric ? static_cast<long long>(theMeshComp.nbFaces()) : 0;
+  const long long nbFacesTotal = nbFacesRef + nbFacesComp;
+  std::vector<double> vectFaceDistances (nbFacesRef);
+  std::vector<RPoint> vectNearestPt (nbFacesRef);
+  std::vector<ProjType> vectProjType (nbFacesRef);
+  DistanceStatistics statsRef, statsComp;
+  unsigned int nbNotFoundRef = 0;
+  unsigned int nbNotFoundComp = 0;
+  unsigned int nbPruned = 0;
+  unsigned int nbInside = 0;
+  std::atomic<long long> nbProcessed {0};
+  // current lower bound of the Hausdorff distance (--hausdorffOnly).
+  std::atomic<double> currentMax {0.0};
   // Brut force distance measure between reference mesh (A) and B:
   // for each face of A we search the face which minimizes the distance (by using face projection, edge projection or center point)
-  
-  int cptFace=0;
-    for (unsigned int i = 0; i<theMeshRef.nbFaces(); i++){
-        std::vector<DGtal::Mesh<Z3i::RealPoint>::Index>  aFace = theMeshRef.getFace(i);
-        cptFace++;
-        trace.progressBar(cptFace, theMeshRef.nbFaces());
-        double distanceMin = std::numeric_limits<double>::max();
-        RPoint cA = theMeshRef.getFaceBarycenter(i);
-        
-        enum ProjType {INSIDE, EDGE, CENTER};
-        ProjType aProjType = INSIDE;
-        vectNearestPt.push_back(cA);
-        auto vFaces = neighorFaces.faceNeighboring(cA);
-        bool fix = vFaces.size() == 0;
-        // compute the minimal distance of the point of A to one face of point B.
-        for (unsigned int j=0; j < vFaces.size(); j++){
-            // project center (cA) of a face of A into faces of B.
-            std::vector<DGtal::Mesh<Z3i::RealPoint>::Index>  aFaceB = theMeshComp.getFace(vFaces[j]);
-            RPoint pB0 = theMeshComp.getVertex(aFaceB.at(0));
-            RPoint pB1 = theMeshComp.getVertex(aFaceB.at(1));
-            RPoint pB2 = theMeshComp.getVertex(aFaceB.at(2));
-            RPoint cB =  theMeshComp.getFaceBarycenter(j);
-            
-            if (useFaceCenterDistance){
-                double distance = (cB-cA).norm();
-                if (distance < distanceMin){
-                    distanceMin = distance;
-                    if (saveNearestPoint) {vectNearestPt[i] = cB;}
-                }
-                continue;
-            }
-            
-            RPoint normal = ((pB0-pB1).crossProduct(pB2 - pB1));
-            RPoint proj = getProjectedPoint(normal, cB, cA);
-            double distance = (proj-cA).norm();
-            
-            if(!isInsideFace(theMeshComp, aFaceB, proj)){
-                // if the projection is outside the face, we approximate the distance with the projection on the face edges
-                RPoint p = cA;
-                bool lineProjOK1 = lineProject(pB0, pB1, p);
-                if(lineProjOK1 && distanceMin > (p-cA).norm()){
-                    distanceMin = (p-cA).norm();
-                    aProjType = EDGE;
-                    if (saveNearestPoint) {vectNearestPt[i] = p;}
-                }
-                p= cA;
-                bool lineProjOK2 = lineProject(pB1, pB2, p);
-                if(lineProjOK2 && distanceMin > (p-cA).norm()){
-                    distanceMin = (p-cA).norm();
-                    aProjType = EDGE;
-                    if (saveNearestPoint) {vectNearestPt[i] = p;}
-                }
-                p= cA;
-                bool lineProjOK3 = lineProject(pB2, pB0, p);
-                if(lineProjOK3 && distanceMin > (p-cA).norm()){
-                    distanceMin = (p-cA).norm();
-                    aProjType = EDGE;
-                    if (saveNearestPoint) {vectNearestPt[i] = p;}
-                }
-                if (!lineProjOK1 && ! lineProjOK2 && ! lineProjOK3 && (cB - cA).norm() < distanceMin){
-                    //if the projection is outside the face, we approximate the distance with the center of face B
-                    distanceMin = (cB - cA).norm();
-                    aProjType = CENTER;
-                    if (saveNearestPoint) {vectNearestPt[i] = cB;}
-                }
-                
+  // The faces of A (and of B in symmetric mode, with the indices greater than nbFacesRef) are processed
+  // in parallel, each thread reports its progress by blocks of faces.
+  trace.progressBar(0, nbFacesTotal);
+#pragma omp parallel reduction(+:nbNotFoundRef, nbNotFoundComp, nbPruned, nbInside)
+  {
+    long long nbLocal = 0;
+    DistanceStatistics localStatsRef, localStatsComp;
+    std::vector<RPoint> points;
+    // minimal distance of a point of A (or of B if fromComp) to the other mesh.
+    auto pointDistance = [&](const RPoint &p, bool fromComp) -> FaceDistance {
+        if (hausdorffOnly){
+            // early exit: the search stops as soon as the point cannot increase the current maximum.
+            double bound = currentMax.load(std::memory_order_relaxed);
+            MeshFaceBVH::Result r = (fromComp ? indexRef.get() : &indexComp)->hierarchy()->closest(p, std::numeric_limits<double>::infinity(), bound);
+            FaceDistance fd {r.distance, r.nearest, r.region == TRIANGLE_INSIDE ? INSIDE : EDGE,
+                             r.distance != std::numeric_limits<double>::infinity()};
+            if (fd.found && fd.distance <= bound){
+                nbPruned++;
             }else{
-                if (distance < distanceMin){
-                    aProjType = INSIDE;
-                    distanceMin = distance;
-                    if (saveNearestPoint) {vectNearestPt[i] = proj;}
-                }
+                while (fd.found && fd.distance > bound &&
+                       !currentMax.compare_exchange_weak(bound, fd.distance, std::memory_order_relaxed)){}
             }
+            return fd;
         }
-        
-        if(distanceMin>maxOfMin){
-            maxOfMin = distanceMin;
+        return fromComp ? indexRef->distance(p) : indexComp.distance(p);
+    };
+#pragma omp for schedule(dynamic, 256)
+    for (long long i = 0; i < nbFacesTotal; i++){
+        const bool fromComp = i >= nbFacesRef;
+        const long long f = fromComp ? i - nbFacesRef : i;
+        RPoint cA = fromComp ? theMeshComp.getFaceBarycenter(f) : theMeshRef.getFaceBarycenter(f);
+        // distance of the face: maximal distance of its points.
+        RPoint facePoint;
+        FaceDistance fd = maxFaceDistance(fromComp ? theMeshComp : theMeshRef, f,
+                                          fromComp ? samplerComp.get() : samplerRef.get(),
+                                          [&](const RPoint &p){ return pointDistance(p, fromComp); },
+                                          points, facePoint, fromComp ? localStatsComp : localStatsRef);
+        // negative distance inside B.
+        if (signedDistance && !fromComp && fd.found && indexComp.isInside(facePoint)){
+            fd.distance = -fd.distance;
+            nbInside++;
         }
-        projOkMesh.setFaceColor(i, aProjType == INSIDE ? DGtal::Color::Blue:  aProjType == EDGE ?  DGtal::Color::Green:  DGtal::Color::White);
-        if (!fix){
-            vectFaceDistances.push_back(distanceMin);
+        if (fromComp){
+            if (!fd.found && !points.empty()){
+                nbNotFoundComp++;
+            }
         }else{
-            vectFaceDistances.push_back(maxScaleDistance);
-
+            vectNearestPt[f] = fd.found && saveNearestPoint ? fd.nearest : cA;
+            vectProjType[f] = fd.projType;
+            if (fd.found){
+                vectFaceDistances[f] = fd.distance;
+            }else if (points.empty()){
+                vectFaceDistances[f] = std::numeric_limits<double>::quiet_NaN();
+            }else{
+                nbNotFoundRef++;
+                vectFaceDistances[f] = maxScaleDistance;
+            }
+        }
+        if (++nbLocal == 4096){
+            long long nb = nbProcessed += nbLocal;
+            nbLocal = 0;
+#pragma omp critical
+            trace.progressBar(nb, nbFacesTotal);
         }
     }
-  
-  std::ofstream outDistances;
-  outDistances.open(outputFileName.c_str(), std::ofstream::out);
-  std::string name  = argv[0];
-  name = name.substr(name.find_last_of("/")+1);
-  outDistances << "# resulting distances computed from the " << name << " program of the DGtalTools-contrib project." << std::endl;
-  outDistances << "# minimal distance between the mesh " << inputMeshName << " to " << inputCompMeshName << std::endl;
-  outDistances << "# format: faceCenter_x faceCenter_y faceCenter_z distanceMin";
- 
-  if (saveNearestPoint) {
-    outDistances << " nearestPoint_x nearestPoint_y nearestPoint_z ";
+#pragma omp critical
+    {
+      statsRef.merge(localStatsRef);
+      statsComp.merge(localStatsComp);
+    }
   }
-  outDistances << std::endl;
-
+  trace.progressBar(nbFacesTotal, nbFacesTotal);
+  const double maxOfMin = statsRef.maximum;
+  for (long long i = 0; i < nbFacesRef; i++){
+    projOkMesh.setFaceColor(i, vectProjType[i] == INSIDE ? DGtal::Color::Blue:  vectProjType[i] == EDGE ?  DGtal::Color::Green:  DGtal::Color::White);
+  }
+  if (nbNotFoundRef != 0){
+    trace.warning() << nbNotFoundRef << " faces without neighbor faces in B (distance set to maxScaleDistance,"
+                    << " increase --searchDistance or --cellGroupSize to search farther)." << std::endl;
+  }
+  if (signedDistance){
+    trace.info() << nbInside << " faces of A inside B (negative distances)." << std::endl;
+  }
+  if (nbNotFoundComp != 0){
+    trace.warning() << nbNotFoundComp << " faces of B without neighbor faces in A (not used in statistics)." << std::endl;
+  }
+  if (hausdorffOnly){
+    trace.info() << "early exit on " << nbPruned << " of " << statsRef.count + statsComp.count << " points." << std::endl;
+    const double hausdorff = std::max(statsRef.maximum, statsComp.maximum);
+    trace.info() << (symmetric ? "symmetric Hausdorff distance: " : "Hausdorff distance from A to B: ")
+                 << hausdorff << std::endl;
+    return 0;
+  }
+  trace.info() << "A to B: ";
+  displayStatistics(statsRef, percentiles);
+  if (symmetric){
+    trace.info() << "B to A: ";
+    displayStatistics(statsComp, percentiles);
+    trace.info() << "symmetric Hausdorff distance: " << std::max(statsRef.maximum, statsComp.maximum) << std::endl;
+  }
+  
+  exportDistances(outputFileName, name, inputMeshName, inputCompMeshName, theNewMeshDistance,
+                  vectFaceDistances, vectNearestPt, params);
 
   DGtal::GradientColorMap<double, CMAP_JET>  gradientShade(minScaleDistance, maxScaleDistance );
+  // diverging color map for the signed distances (blue inside B, red outside).
+  DGtal::GradientColorMap<double> signedShade(-maxScaleDistance, maxScaleDistance);
+  signedShade.addColor(DGtal::Color::Blue);
+  signedShade.addColor(DGtal::Color::White);
+  signedShade.addColor(DGtal::Color::Red);
   for (unsigned int i=0; i< theNewMeshDistance.nbFaces(); i++){
-    RPoint center = theNewMeshDistance.getFaceBarycenter(i);
-    theNewMeshDistance.setFaceColor(i, gradientShade(std::min((squaredDistance ? vectFaceDistances[i] :
-                                                              1.0 )* vectFaceDistances[i], maxScaleDistance)));
-    outDistances << center[0] << " " << center[1] << " " << center[2] << " " << vectFaceDistances[i];
-    if (saveNearestPoint)
-    {
-      outDistances << " " << vectNearestPt[i][0] << " " << vectNearestPt[i][1] << " " << vectNearestPt[i][2];
+    if (std::isnan(vectFaceDistances[i])){
+      // face without sample
+      theNewMeshDistance.setFaceColor(i, DGtal::Color::White);
+    }else if (signedDistance){
+      const double d = (squaredDistance ? std::abs(vectFaceDistances[i]) : 1.0)*vectFaceDistances[i];
+      theNewMeshDistance.setFaceColor(i, signedShade(std::max(-maxScaleDistance, std::min(d, maxScaleDistance))));
+    }else{
+      theNewMeshDistance.setFaceColor(i, gradientShade(std::min((squaredDistance ? vectFaceDistances[i] :
+                                                                1.0 )* vectFaceDistances[i], maxScaleDistance)));
     }
-    outDistances<< std::endl;
   }
-  outDistances.close();
   
   if (squaredDistance) {
     trace.info()<< "maximal of minimum squared distance : " << maxOfMin << std::endl;
@@ -426,11 +1490,8 @@ main(int argc,char **argv)
     trace.info()<< "maximal of minimum distance: " << maxOfMin << std::endl;
   }
   
-  std::ofstream outMesh;
   if(outputMeshFileName.size()>0){
-    outMesh.open(outputMeshFileName.c_str(), std::ofstream::out);
-    MeshWriter<Z3i::RealPoint>::export2OFF(outMesh, theNewMeshDistance,true);
-    outMesh.close();
+    exportMesh(outputMeshFileName, theNewMeshDistance);
   }
   
   if(exportDistanceEstimationType){
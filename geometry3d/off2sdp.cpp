@@ -35,6 +35,8 @@
 
 #include "CLI11.hpp"
 
+#include "PointSetWriter.h"
+
 #include <iostream>
 #include <fstream>
 
@@ -64,6 +66,8 @@ using namespace DGtal;
    -i,--input TEXT:FILE REQUIRED         the input mesh filename (.off).
    -o,--output TEXT                      the output filename (.sdp).
    -f,--faceCenter                       export the face centers instead the mesh vertex.
+   --outputFormat TEXT:{text,bin,npy,sparse}=text
+                                         format of the output: text (sdp), bin (rows x y z of 32 bit floats), npy (same array with a NumPy header); sparse is only defined for voxels (text is used).
    @endcode
 
  @b Example: 
@@ -85,6 +89,7 @@ int main( int argc, char** argv )
   std::string inputFileName;
   std::string outputFileName {"result.sdp"};
   bool faceCenter {false};
+  std::string outputFormat {"text"};
   app.description("Converts a mesh into a set of points (.sdp)."
                   "It can extract the mesh vertices (by default) or the center of faces."
                   "Typical use example:\n \t off2sdp  $DGtal/examples/samples/tref.off  test.sdp  \n");
@@ -95,6 +100,9 @@ int main( int argc, char** argv )
   
   app.add_option("--output,-o,2",outputFileName, "the output filename (.sdp).");
   app.add_flag("--faceCenter,-f", faceCenter, "export the face centers instead the mesh vertex.");
+  app.add_option("--outputFormat", outputFormat, "format of the output: text (sdp), bin (rows x y z of 32 bit floats),"
+                 " npy (same array with a NumPy header); sparse is only defined for voxels (text is used).")
+  ->check(CLI::IsMember(pointSetFormatNames()));
   
   
   app.get_formatter()->column_width(40);
@@ -109,15 +117,13 @@ int main( int argc, char** argv )
   aMesh << inputFileName ;
   
   // export
-  ofstream fout;
-  fout.open(outputFileName.c_str());
-  fout<< "# set of points extracted from the tools off2sdp with input file " << inputFileName << std::endl;
+  std::vector<double> rows;
   if(!faceCenter)
     {
       for(unsigned int i=0; i<aMesh.nbVertex(); i++ )
         {
           DGtal::Z3i::RealPoint p = aMesh.getVertex(i);
-          fout << p[0] << " " << p[1] << " " << p[2] << std::endl;
+          rows.insert(rows.end(), {p[0], p[1], p[2]});
         }
     }
   else
@@ -125,10 +131,14 @@ int main( int argc, char** argv )
       for(unsigned int i=0; i<aMesh.nbFaces(); i++ )
         {
           DGtal::Z3i::RealPoint p = aMesh.getFaceBarycenter(i);
-          fout << p[0] << " " << p[1] << " " << p[2] << std::endl;
+          rows.insert(rows.end(), {p[0], p[1], p[2]});
         }
     }  
-  fout.close();
+  if (!exportPointSet(outputFileName, pointSetFormat(outputFormat), rows, 3,
+                      "set of points extracted from the tools off2sdp with input file " + inputFileName)){
+    trace.error() << "can't write the output file " << outputFileName << std::endl;
+    return 1;
+  }
   return 0;
 }
 
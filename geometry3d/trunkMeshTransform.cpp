@@ -42,6 +42,8 @@
 #include <fstream>
 
 #include "CLI11.hpp"
+
+#include "PointSetWriter.h"
 ///////////////////////////////////////////////////////////////////////////////
 using namespace std;
 using namespace DGtal;
@@ -78,6 +80,8 @@ using namespace DGtal;
    -m,--mainDir FLOAT x 3                Define the main direction to define the filtering angle based (see --filterFacePosition and --filterFaceNormal
    -o,--outputMesh TEXT                  Output mesh file name.
    --outputPoints TEXT                   Output pts file name
+   --outputFormat TEXT:{text,bin,npy,sparse}=text
+                                         format of the output points (--outputPoints): text (pts), bin (rows x y z of 32 bit floats), npy (same array with a NumPy header); sparse is only defined for voxels (text is used).
  @code
  -h [ --help ]           display this message
  -i [ --input ] arg      an input file...
@@ -213,6 +217,7 @@ int main( int argc, char** argv )
     std::string inputPithFileName;
     std::string outputMesh = "result.off";
     std::string outputPts = "result.pts";
+    std::string outputFormat = "text";
 
     std::string outputBaseName {"resDeform"};
     std::stringstream usage;
@@ -255,6 +260,9 @@ int main( int argc, char** argv )
     auto vSOpt = app.add_option("--vSampleAngularSensi", vSampleAngularSensi, "Defines the vertical angular sensibility laser scan intersection detection. (effect only with --verticalSampling) ");
     auto outMesh = app.add_option("--outputMesh,-o,3", outputMesh, "Output mesh file name.");
     auto outPts = app.add_option("--outputPoints", outputPts, "Output pts file name");
+    app.add_option("--outputFormat", outputFormat, "format of the output points (--outputPoints): text (pts), bin (rows x y z"
+                   " of 32 bit floats), npy (same array with a NumPy header); sparse is only defined for voxels (text is used).")
+    ->check(CLI::IsMember(pointSetFormatNames()));
     app.get_formatter()->column_width(40);
     CLI11_PARSE(app, argc, argv);
     // END parse command line using CLI ----------------------------------------------
@@ -365,13 +373,15 @@ int main( int argc, char** argv )
     }
     if (outPts->count() > 0 ){
         trace.info() << "Writing output points...";
-        
-        ofstream fout;
-        fout.open(outputPts);
+        std::vector<double> rows;
+        rows.reserve(3*resultingMesh.nbVertex());
         for (auto it = resultingMesh.vertexBegin(); it != resultingMesh.vertexEnd(); it++){
-            fout << (*it)[0] << " " << (*it)[1] << " " << (*it)[2] << std::endl;
+            rows.insert(rows.end(), {(*it)[0], (*it)[1], (*it)[2]});
+        }
+        if (!exportPointSet(outputPts, pointSetFormat(outputFormat), rows, 3, "")){
+            trace.error() << "can't write the output file " << outputPts << std::endl;
+            return 1;
         }
-        fout.close();
         trace.info() << "[done]." << std::endl;
     }
     return 0;
@@ -26,6 +26,9 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
 #include "DGtal/base/Common.h"
 #include "DGtal/helpers/StdDefs.h"
 #include "DGtal/io/readers/GenericReader.h"
@@ -34,13 +37,17 @@
 
 #include "CLI11.hpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 using namespace DGtal;
 using namespace Z3i;
 
 /**
  @code:
-Fills each Connected Components by using as intensity the number of voxels of the CC. The input file is supposed to be segmented (ie each CC is represented by its labels (integer)).
+Fills each Connected Components by using as intensity the number of voxels of the CC. The input file is supposed to be segmented (ie each CC is represented by its labels (integer)), or with --label a binary (or thresholded) volume whose connected components are labelled first.
 Usage: ./geometry3d/volFillCCSize [OPTIONS] 1 2
 
 Positionals:
@@ -53,6 +60,9 @@ Options:
   -o,--output TEXT REQUIRED             Output volume file (.vol) , pgm3d (.p3d or .pgm3d, pgm (with 3 dims)).
   --bgValue INT=0                       Consider this value as background in order to ignore it from the filling.
   --rescale                             Rescale the output to fit unsigned char image representation.
+  --label                               Label the connected components of the voxels which are not of the background value (binary or thresholded volume) instead of reading labels.
+  --connectivity UINT:{6,18,26}=26      connectivity of the components with --label.
+  --threads UINT=0                      number of threads used to process the slabs of the volume (0: default number of threads).
 
  */
 ///////////////////////////////////////////////////////////////////////////////
@@ -62,43 +72,420 @@ typedef ImageContainerBySTLVector<Z3i::Domain, unsigned int> Image3DI;
 
 
 
+/**
+ * Number of voxels of labels with arbitrary 32-bit values, in a flat hash
+ * table with open addressing (linear probing) whose capacity is a power of
+ * two kept at least twice the number of labels. The empty slots hold the
+ * empty label (the background label of the tools), so that any 32-bit
+ * value except the empty label can be counted: the empty label itself is
+ * never stored and its count is always 0.
+ */
+class LabelCounts
+{
+public:
+  LabelCounts(DGtal::uint32_t anEmptyLabel = 0):
+    myEmptyLabel(anEmptyLabel), myNbLabels(0),
+    myLabels(1024, anEmptyLabel), myCounts(1024, 0)
+  {}
+
+  /**
+   * Adds n voxels to a label (different from the empty label).
+   */
+  void
+  add(DGtal::uint32_t aLabel, DGtal::uint64_t n)
+  {
+    std::size_t i = slot(aLabel);
+    if (myLabels[i] == myEmptyLabel){
+      if (2*(myNbLabels + 1) > myLabels.size()){
+        grow();
+        i = slot(aLabel);
+      }
+      myLabels[i] = aLabel;
+      myNbLabels++;
+    }
+    myCounts[i] += n;
+  }
+
+  /**
+   * @return the number of voxels of a label (0 if it was never added).
+   */
+  DGtal::uint64_t
+  count(DGtal::uint32_t aLabel) const
+  {
+    const std::size_t i = slot(aLabel);
+    return myLabels[i] == aLabel ? myCounts[i] : 0;
+  }
+
+  /**
+   * Adds the counts of another table.
+   */
+  void
+  merge(const LabelCounts &other)
+  {
+    for (std::size_t i = 0; i < other.myLabels.size(); i++){
+      if (other.myLabels[i] != other.myEmptyLabel){
+        add(other.myLabels[i], other.myCounts[i]);
+      }
+    }
+  }
+
+  std::size_t
+  nbLabels() const
+  {
+    return myNbLabels;
+  }
+
+  DGtal::uint64_t
+  maxCount() const
+  {
+    return myCounts.empty() ? 0 : *std::max_element(myCounts.begin(), myCounts.end());
+  }
+
+private:
+  /**
+   * @return the slot of a label or the empty slot where it would be added.
+   */
+  std::size_t
+  slot(DGtal::uint32_t aLabel) const
+  {
+    const std::size_t mask = myLabels.size() - 1;
+    // multiplicative hashing (Fibonacci) of the label.
+    std::size_t i = (static_cast<DGtal::uint64_t>(aLabel)*0x9E3779B97F4A7C15ULL >> 32) & mask;
+    while (myLabels[i] != aLabel && myLabels[i] != myEmptyLabel){
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  void
+  grow()
+  {
+    std::vector<DGtal::uint32_t> labels (2*myLabels.size(), myEmptyLabel);
+    std::vector<DGtal::uint64_t> counts (2*myLabels.size(), 0);
+    labels.swap(myLabels);
+    counts.swap(myCounts);
+    for (std::size_t i = 0; i < labels.size(); i++){
+      if (labels[i] != myEmptyLabel){
+        const std::size_t j = slot(labels[i]);
+        myLabels[j] = labels[i];
+        myCounts[j] = counts[i];
+      }
+    }
+  }
+
+  DGtal::uint32_t myEmptyLabel;
+  std::size_t myNbLabels;
+  std::vector<DGtal::uint32_t> myLabels;
+  std::vector<DGtal::uint64_t> myCounts;
+};
+
+
+/**
+ * Fills each labelled CC of an image with its number of voxels (the
+ * background keeps the value 0).
+ *
+ * The voxels are counted in parallel by chunks of the image, each thread
+ * having its own counters: a vector indexed by the labels when their range
+ * is small (the counters of all the threads take at most the size of the
+ * image), otherwise a flat hash table where the runs of equal labels are
+ * added at once, so that any label values can be used. The counters of the threads are then
+ * summed and the output is filled in parallel from the counts.
+ *
+ * @param anImage the labelled image.
+ * @param anImageOut the output image (same domain).
+ * @param bg the background label.
+ * @return the maximal size of the components.
+ */
 template<typename TImage, typename TImageOut>
 unsigned int
 intensityFromNbVoxCC(const TImage &anImage,  TImageOut &anImageOut, unsigned int bg = 0){
-  auto maxLabel = *(std::max_element(anImage.begin(), anImage.end()));
-  //tab representing for each intensity label, the number of voxels that belongs to the CC.
-  std::vector< DGtal::uint64_t> nbVox(static_cast< DGtal::uint64_t>(maxLabel));
+  const auto *labels = anImage.data();
+  auto *out = anImageOut.data();
+  const std::size_t size = anImage.size();
+  const long long n = static_cast<long long>(size);
+  const DGtal::uint32_t background = bg;
+  DGtal::uint64_t maxLabel = 0;
+#pragma omp parallel
+  {
+    DGtal::uint64_t threadMaxLabel = 0;
+#pragma omp for schedule(static) nowait
+    for (long long i = 0; i < n; i++){
+      threadMaxLabel = std::max<DGtal::uint64_t>(threadMaxLabel, labels[i]);
+    }
+#pragma omp critical
+    maxLabel = std::max(maxLabel, threadMaxLabel);
+  }
+  int nbThreads = 1;
+#ifdef _OPENMP
+  nbThreads = omp_get_max_threads();
+#endif
+  const bool isDense = (maxLabel + 1)*nbThreads <= std::max<std::size_t>(size, 1 << 16);
+  DGtal::uint64_t max = 0;
+
   DGtal::trace.beginBlock("Counting CC size");
-  DGtal::trace.info() << "Found #CC: " << static_cast<unsigned int>(maxLabel) << std::endl;
-  DGtal::trace.progressBar(0, anImage.domain().size());
-  unsigned int i = 0;
-  unsigned int max = 0;
-  for(auto &p: anImage.domain()){
-    DGtal::trace.progressBar(i, anImage.domain().size());
-    nbVox[anImage(p)]++;
-    if (nbVox[anImage(p)] > max && anImage(p) != bg )
+  if (isDense){
+    std::vector<DGtal::uint64_t> nbVox (maxLabel + 1, 0);
+#pragma omp parallel
     {
-      max = nbVox[anImage(p)];
+      std::vector<DGtal::uint64_t> threadNbVox (maxLabel + 1, 0);
+#pragma omp for schedule(static)
+      for (long long i = 0; i < n; i++){
+        threadNbVox[labels[i]]++;
+      }
+#pragma omp critical
+      for (std::size_t l = 0; l <= maxLabel; l++){
+        nbVox[l] += threadNbVox[l];
+      }
+    }
+    std::size_t nbCC = 0;
+    for (std::size_t l = 0; l <= maxLabel; l++){
+      if (l != background && nbVox[l] > 0){
+        nbCC++;
+        max = std::max(max, nbVox[l]);
+      }
+    }
+    DGtal::trace.info() << "Found #CC: " << nbCC << std::endl;
+    DGtal::trace.endBlock();
+
+    DGtal::trace.beginBlock("Filling CC using #CC");
+#pragma omp parallel for schedule(static)
+    for (long long i = 0; i < n; i++){
+      out[i] = labels[i] != background ? static_cast<DGtal::uint32_t>(nbVox[labels[i]]) : 0;
+    }
+  }else{
+    LabelCounts nbVox (background);
+    std::vector<LabelCounts> threadNbVox (nbThreads, LabelCounts(background));
+#pragma omp parallel for schedule(static, 1)
+    for (int t = 0; t < nbThreads; t++){
+      LabelCounts &counts = threadNbVox[t];
+      const std::size_t begin = (size*t)/nbThreads;
+      const std::size_t end = (size*(t + 1))/nbThreads;
+      // the labels are added by runs of equal values.
+      std::size_t i = begin;
+      while (i < end){
+        std::size_t j = i + 1;
+        while (j < end && labels[j] == labels[i]) j++;
+        if (labels[i] != background){
+          counts.add(labels[i], j - i);
+        }
+        i = j;
+      }
+    }
+    for (const auto &counts: threadNbVox){
+      nbVox.merge(counts);
+    }
+    max = nbVox.maxCount();
+    DGtal::trace.info() << "Found #CC: " << nbVox.nbLabels() << std::endl;
+    DGtal::trace.endBlock();
+
+    DGtal::trace.beginBlock("Filling CC using #CC");
+#pragma omp parallel for schedule(static)
+    for (long long i = 0; i < n; i++){
+      out[i] = labels[i] != background ? static_cast<DGtal::uint32_t>(nbVox.count(labels[i])) : 0;
     }
-    i++;
   }
   DGtal::trace.endBlock();
+  return static_cast<unsigned int>(max);
+}
 
-  DGtal::trace.beginBlock("Filling CC using #CC");
-  DGtal::trace.progressBar(0, anImage.domain().size());
-  i=0;
-  for(auto &p: anImage.domain()){
-    DGtal::trace.progressBar(i, anImage.domain().size());
-    if (anImage(p) != bg){
-      anImageOut.setValue(p,  static_cast< DGtal::uint64_t>(nbVox[anImage(p)]));
+
+
+/**
+ * @return the offsets of the neighbors of a voxel which precede it in the
+ * linear order of the image (x first) for the 6, 18 or 26 connectivity.
+ */
+static
+std::vector<Z3i::Point>
+backwardNeighbors(unsigned int connectivity)
+{
+  std::vector<Z3i::Point> res;
+  for (int dz = -1; dz <= 0; dz++){
+    for (int dy = -1; dy <= 1; dy++){
+      for (int dx = -1; dx <= 1; dx++){
+        if (dz == 0 && (dy > 0 || (dy == 0 && dx >= 0))) continue;
+        const unsigned int norm = std::abs(dx) + std::abs(dy) + std::abs(dz);
+        if ((connectivity == 6 && norm > 1) || (connectivity == 18 && norm > 2)) continue;
+        res.push_back(Z3i::Point(dx, dy, dz));
+      }
+    }
+  }
+  return res;
+}
+
+
+/**
+ * Union-find on labels: the root of a label is the smallest label of its
+ * set.
+ */
+static
+DGtal::uint32_t
+findRoot(std::vector<DGtal::uint32_t> &parent, DGtal::uint32_t l)
+{
+  while (parent[l] != l){
+    parent[l] = parent[parent[l]];
+    l = parent[l];
+  }
+  return l;
+}
+
+static
+void
+unite(std::vector<DGtal::uint32_t> &parent, DGtal::uint32_t a, DGtal::uint32_t b)
+{
+  a = findRoot(parent, a);
+  b = findRoot(parent, b);
+  if (a < b){
+    parent[b] = a;
+  }else{
+    parent[a] = b;
+  }
+}
+
+
+/**
+ * Labels the connected components of the foreground voxels of an image
+ * and fills each one with its number of voxels (0 for the background).
+ *
+ * The z slabs of the image are labelled in parallel with a union-find on
+ * provisional labels (the neighbors preceding a voxel inside its slab),
+ * which also counts the voxels of each provisional label. The labels of
+ * the slabs are then put in a single union-find, merged across the first
+ * plane of each slab, and the size of each component is the sum of the
+ * counts of its provisional labels. The output image holds the
+ * provisional labels before being filled in parallel with the sizes.
+ *
+ * @param anImage the input image.
+ * @param anImageOut the output image (same domain).
+ * @param isForeground the predicate on the values of the foreground.
+ * @param connectivity the connectivity of the components (6, 18 or 26).
+ * @return the maximal size of the components.
+ */
+template<typename TImage, typename TImageOut, typename TPredicate>
+unsigned int
+intensityFromCCLabelling(const TImage &anImage, TImageOut &anImageOut,
+                         const TPredicate &isForeground, unsigned int connectivity)
+{
+  const Z3i::Point extent = anImage.domain().upperBound() - anImage.domain().lowerBound();
+  const int nx = extent[0] + 1;
+  const int ny = extent[1] + 1;
+  const int nz = extent[2] + 1;
+  const std::size_t sliceSize = static_cast<std::size_t>(nx)*ny;
+  const std::vector<Z3i::Point> neighbors = backwardNeighbors(connectivity);
+  int nbSlabs = 1;
+#ifdef _OPENMP
+  nbSlabs = std::max(1, std::min(nz, omp_get_max_threads()));
+#endif
+  std::vector<int> slabBegin (nbSlabs + 1);
+  for (int s = 0; s <= nbSlabs; s++){
+    slabBegin[s] = static_cast<int>((static_cast<long>(nz)*s)/nbSlabs);
+  }
+  const auto *values = anImage.data();
+  auto *labels = anImageOut.data();
+  std::vector<std::vector<DGtal::uint32_t>> slabParent (nbSlabs);
+  std::vector<std::vector<DGtal::uint64_t>> slabCount (nbSlabs);
+
+  DGtal::trace.beginBlock("Labelling CC by slabs");
+#pragma omp parallel for schedule(static, 1)
+  for (int s = 0; s < nbSlabs; s++){
+    std::vector<DGtal::uint32_t> &parent = slabParent[s];
+    std::vector<DGtal::uint64_t> &count = slabCount[s];
+    parent.assign(1, 0);
+    count.assign(1, 0);
+    for (int z = slabBegin[s]; z < slabBegin[s + 1]; z++){
+      for (int y = 0; y < ny; y++){
+        for (int x = 0; x < nx; x++){
+          const std::size_t i = x + nx*(y + ny*static_cast<std::size_t>(z));
+          if (!isForeground(values[i])){
+            labels[i] = 0;
+            continue;
+          }
+          DGtal::uint32_t label = 0;
+          for (const auto &o: neighbors){
+            if (x + o[0] < 0 || x + o[0] >= nx || y + o[1] < 0 || y + o[1] >= ny ||
+                z + o[2] < slabBegin[s]) continue;
+            const DGtal::uint32_t l = labels[i + o[0] + nx*o[1] + sliceSize*o[2]];
+            if (l == 0) continue;
+            if (label == 0){
+              label = l;
+            }else if (l != label){
+              unite(parent, label, l);
+            }
+          }
+          if (label == 0){
+            label = static_cast<DGtal::uint32_t>(parent.size());
+            parent.push_back(label);
+            count.push_back(0);
+          }
+          labels[i] = label;
+          count[label]++;
+        }
+      }
     }
-    i++;
   }
   DGtal::trace.endBlock();
-  return max;
 
+  DGtal::trace.beginBlock("Merging CC of the slabs");
+  // the provisional labels of slab s are shifted by slabOffset[s].
+  std::vector<DGtal::uint32_t> slabOffset (nbSlabs + 1, 0);
+  for (int s = 0; s < nbSlabs; s++){
+    slabOffset[s + 1] = slabOffset[s] + static_cast<DGtal::uint32_t>(slabParent[s].size() - 1);
+  }
+  std::vector<DGtal::uint32_t> parent (slabOffset[nbSlabs] + 1, 0);
+  std::vector<DGtal::uint64_t> size (slabOffset[nbSlabs] + 1, 0);
+  for (int s = 0; s < nbSlabs; s++){
+    for (DGtal::uint32_t l = 1; l < slabParent[s].size(); l++){
+      parent[slabOffset[s] + l] = slabOffset[s] + findRoot(slabParent[s], l);
+    }
+  }
+  for (int s = 1; s < nbSlabs; s++){
+    const int z = slabBegin[s];
+    if (z >= slabBegin[s + 1]) continue;
+    for (int y = 0; y < ny; y++){
+      for (int x = 0; x < nx; x++){
+        const std::size_t i = x + nx*(y + ny*static_cast<std::size_t>(z));
+        if (labels[i] == 0) continue;
+        for (const auto &o: neighbors){
+          if (o[2] == 0 || x + o[0] < 0 || x + o[0] >= nx || y + o[1] < 0 || y + o[1] >= ny) continue;
+          const DGtal::uint32_t l = labels[i + o[0] + nx*o[1] - sliceSize];
+          if (l != 0){
+            unite(parent, slabOffset[s] + labels[i], slabOffset[s - 1] + l);
+          }
+        }
+      }
+    }
+  }
+  for (int s = 0; s < nbSlabs; s++){
+    for (DGtal::uint32_t l = 1; l < slabParent[s].size(); l++){
+      size[findRoot(parent, slabOffset[s] + l)] += slabCount[s][l];
+    }
+  }
+  DGtal::uint64_t max = 0;
+  unsigned int nbCC = 0;
+  for (DGtal::uint32_t l = 1; l < parent.size(); l++){
+    if (findRoot(parent, l) == l){
+      nbCC++;
+    }
+    size[l] = size[findRoot(parent, l)];
+    max = std::max(max, size[l]);
+  }
+  DGtal::trace.info() << "Found #CC: " << nbCC << std::endl;
+  DGtal::trace.endBlock();
+
+  DGtal::trace.beginBlock("Filling CC using #CC");
+#pragma omp parallel for schedule(static, 1)
+  for (int s = 0; s < nbSlabs; s++){
+    for (std::size_t i = sliceSize*slabBegin[s]; i < sliceSize*slabBegin[s + 1]; i++){
+      if (labels[i] != 0){
+        labels[i] = static_cast<DGtal::uint32_t>(size[slabOffset[s] + labels[i]]);
+      }
+    }
+  }
+  DGtal::trace.endBlock();
+  return static_cast<unsigned int>(max);
 }
 
+
+
 int main( int argc, char** argv )
 {
   // parse command line CLI-------------------------------------------------------
@@ -108,29 +495,48 @@ int main( int argc, char** argv )
   std::string outputFilename;
   int bgValue {0};
   bool rescale {false};
+  bool label {false};
+  unsigned int connectivity {26};
+  unsigned int nbThreads {0};
   
   app.add_option("--input,-i,1", inputFilename, "vol file (.vol) , pgm3d (.p3d or .pgm3d, pgm (with 3 dims))")->required()->check(CLI::ExistingFile);
   app.add_option("--output,-o,2", outputFilename, "Output volume file (.vol) , pgm3d (.p3d or .pgm3d, pgm (with 3 dims)).")->required();
   app.add_option("--bgValue",bgValue, "Consider this value as background in order to ignore it from the filling." );
   app.add_flag("--rescale", rescale, "Rescale the output to fit unsigned char image representation." );
+  app.add_flag("--label", label, "Label the connected components of the voxels which are not of the background value (binary or thresholded volume) instead of reading labels." );
+  app.add_option("--connectivity", connectivity, "connectivity of the components with --label.")
+  ->check(CLI::IsMember({6, 18, 26}));
+  app.add_option("--threads", nbThreads, "number of threads used to process the slabs of the volume (0: default number of threads).");
   app.get_formatter()->column_width(40);
   CLI11_PARSE(app, argc, argv);
   // END parse command line using CLI ----------------------------------------------
 
+#ifdef _OPENMP
+  if (nbThreads > 0){
+    omp_set_num_threads(nbThreads);
+  }
+#endif
+
   Image3DI image = GenericReader<Image3DI>::import(inputFilename);
+  Image3DI imageOut (image.domain());
+  unsigned int m;
+  if (label)
+  {
+    const unsigned int bg = bgValue;
+    m = intensityFromCCLabelling(image, imageOut, [bg](unsigned int v){ return v != bg; }, connectivity);
+  }
+  else
+  {
+    m = intensityFromNbVoxCC(image, imageOut, bgValue);
+  }
+  DGtal::trace.info() << "nb CC max: " << m << std::endl;
 
   if(!rescale)
   {
-    Image3DI imageOut (image.domain());
-    unsigned int m = intensityFromNbVoxCC(image, imageOut, bgValue);
-    DGtal::trace.info() << "nb CC max: " << m << std::endl;
     GenericWriter<Image3DI>::exportFile(outputFilename, imageOut);
   }
   else
   {
-    Image3DI imageOut (image.domain());
-    unsigned int m = intensityFromNbVoxCC(image, imageOut, bgValue);
-    DGtal::trace.info() << "nb CC max: " << m << std::endl;
     typedef DGtal::functors::Rescaling<unsigned int ,unsigned char> RescalFCT;
     typedef ConstImageAdapter<Image3DI, Image3D::Domain, functors::Identity, unsigned char, RescalFCT> ImageAdapt;
     functors::Identity id;
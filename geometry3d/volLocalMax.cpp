@@ -26,15 +26,27 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 #include <iostream>
+#include <fstream>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <type_traits>
 #include "DGtal/base/Common.h"
 #include "DGtal/helpers/StdDefs.h"
-#include "DGtal/io/readers/GenericReader.h"
 #include "DGtal/images/ImageContainerBySTLVector.h"
-#include "DGtal/shapes/implicit/ImplicitBall.h"
-#include "DGtal/shapes/GaussDigitizer.h"
 
 #include "CLI11.hpp"
 
+#include "StructuringElement3D.h"
+#include "TypedVolumeIO.h"
+#include "PointSetWriter.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 using namespace DGtal;
 using namespace Z3i;
@@ -55,34 +67,231 @@ Options:
   -i,--input TEXT:FILE REQUIRED         vol file (.vol) , pgm3d (.p3d or .pgm3d, pgm (with 3 dims)) file
   -o,--output TEXT REQUIRED             Output SDP filename
   -b,--ballSize FLOAT=3                 set the ball size
+  --outputFormat TEXT:{text,bin,npy,sparse}=text
+                                        format of the output: text (sdp), bin (rows x y z value of 32 bit integers, 64 bit when a value does not fit in 32 bits, or floats for a float volume), npy (same array with a NumPy header) or sparse (voxels sorted and delta encoded, see PointSetWriter.h).
+  --plateaus                            also extract the plateaus of maxima (voxels equal to the maximum of their ball): one voxel (the nearest to the centroid) per 26-connected set of such voxels with the same value.
+  --threads UINT=0                      number of threads used to process the slabs of the volume (0: default number of threads).
+  --rawSize UINT x 3                    size X Y Z of a raw input volume.
+  --rawType TEXT:{uint8,uint16,uint32,float}=uint8
+                                        type of the values of a raw input volume.
 */ 
 ///////////////////////////////////////////////////////////////////////////////
 
-typedef ImageContainerBySTLVector<Z3i::Domain, unsigned char> Image3D;
+/**
+ * Groups the voxels of plateaus (equal to the maximum of their ball) in
+ * 26-connected components of equal values with a union-find, and keeps
+ * the voxel of each component which is the nearest to its centroid. A
+ * component with a neighbor of the same value which is not a voxel of a
+ * plateau is not a maximum (a flat zone near greater values, such as the
+ * background) and is ignored.
+ *
+ * The neighbors are found in a hash table (open addressing) of the plateau
+ * voxels. The z slabs are processed in parallel, each one uniting the
+ * voxels of its own slab (the union-find of the voxels of a slab only
+ * links voxels of the slab), then the neighbors across the first slice of
+ * each slab are united.
+ *
+ * @param image the volume.
+ * @param plateau the linear indices of the voxels of the plateaus (sorted).
+ * @return the linear indices of the representatives of the components.
+ */
+template<typename TImage>
+std::vector<std::size_t>
+plateauRepresentatives(const TImage &image, const std::vector<std::size_t> &plateau)
+{
+  const Point extent = image.domain().upperBound() - image.domain().lowerBound();
+  const long nx = extent[0] + 1;
+  const long ny = extent[1] + 1;
+  const long nz = extent[2] + 1;
+  const std::size_t sliceSize = static_cast<std::size_t>(nx)*ny;
+  const std::size_t none = std::numeric_limits<std::size_t>::max();
+  // hash table of the plateau voxels: linear index -> position in plateau.
+  std::size_t capacity = 16;
+  while (capacity < 2*plateau.size()) capacity *= 2;
+  const std::size_t mask = capacity - 1;
+  std::vector<std::size_t> hashKeys (capacity, none);
+  std::vector<std::size_t> hashPositions (capacity, 0);
+  auto hash = [mask](std::size_t aKey){
+    return static_cast<std::size_t>((static_cast<DGtal::uint64_t>(aKey)*0x9E3779B97F4A7C15ULL) >> 17) & mask;
+  };
+  for (std::size_t i = 0; i < plateau.size(); i++){
+    std::size_t h = hash(plateau[i]);
+    while (hashKeys[h] != none) h = (h + 1) & mask;
+    hashKeys[h] = plateau[i];
+    hashPositions[h] = i;
+  }
+  auto position = [&](std::size_t q){
+    for (std::size_t h = hash(q); hashKeys[h] != none; h = (h + 1) & mask){
+      if (hashKeys[h] == q) return hashPositions[h];
+    }
+    return none;
+  };
+  std::vector<std::size_t> parent (plateau.size());
+  std::vector<char> isOpen (plateau.size(), 0);
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&parent](std::size_t i){
+    while (parent[i] != i){
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  };
+  int nbSlabs = 1;
+#ifdef _OPENMP
+  nbSlabs = static_cast<int>(std::max(1L, std::min(nz, static_cast<long>(omp_get_max_threads()))));
+#endif
+  // the voxels of the slab s are plateau[slabBegin[s]] ... plateau[slabBegin[s+1]-1].
+  std::vector<long> slabZ (nbSlabs + 1);
+  std::vector<std::size_t> slabBegin (nbSlabs + 1);
+  for (int s = 0; s <= nbSlabs; s++){
+    slabZ[s] = (nz*s)/nbSlabs;
+    slabBegin[s] = std::lower_bound(plateau.begin(), plateau.end(), sliceSize*slabZ[s]) - plateau.begin();
+  }
+  // unites the voxel i with its neighbor q (q < plateau[i]) or marks it as open.
+  auto linkNeighbor = [&](std::size_t i, std::size_t q, bool withUnion){
+    if (image.data()[q] != image.data()[plateau[i]]) return;
+    const std::size_t j = position(q);
+    if (j == none){
+      isOpen[i] = 1;
+    }else if (withUnion && q < plateau[i]){
+      parent[find(j)] = find(i);
+    }
+  };
+#pragma omp parallel for schedule(static, 1)
+  for (int s = 0; s < nbSlabs; s++){
+    for (std::size_t i = slabBegin[s]; i < slabBegin[s + 1]; i++){
+      const long x = plateau[i] % nx;
+      const long y = (plateau[i] / nx) % ny;
+      const long z = plateau[i] / sliceSize;
+      for (long dz = -1; dz <= 1; dz++){
+        for (long dy = -1; dy <= 1; dy++){
+          for (long dx = -1; dx <= 1; dx++){
+            if (x + dx < 0 || x + dx >= nx || y + dy < 0 || y + dy >= ny || z + dz < 0 || z + dz >= nz) continue;
+            if (dx == 0 && dy == 0 && dz == 0) continue;
+            linkNeighbor(i, plateau[i] + dx + nx*(dy + ny*dz), z + dz >= slabZ[s]);
+          }
+        }
+      }
+    }
+  }
+  // neighbors in the previous slab of the voxels of the first slice of a slab.
+  for (int s = 1; s < nbSlabs; s++){
+    for (std::size_t i = slabBegin[s]; i < slabBegin[s + 1] && plateau[i] < sliceSize*(slabZ[s] + 1); i++){
+      const long x = plateau[i] % nx;
+      const long y = (plateau[i] / nx) % ny;
+      for (long dy = -1; dy <= 1; dy++){
+        for (long dx = -1; dx <= 1; dx++){
+          if (x + dx < 0 || x + dx >= nx || y + dy < 0 || y + dy >= ny) continue;
+          linkNeighbor(i, plateau[i] + dx + nx*(dy - ny), true);
+        }
+      }
+    }
+  }
+  std::vector<std::size_t> root (plateau.size());
+  std::vector<double> centroid (3*plateau.size(), 0.0);
+  std::vector<std::size_t> size (plateau.size(), 0);
+  std::vector<bool> isRootOpen (plateau.size(), false);
+  for (std::size_t i = 0; i < plateau.size(); i++){
+    root[i] = find(i);
+    if (isOpen[i]) isRootOpen[root[i]] = true;
+    centroid[3*root[i]] += plateau[i] % nx;
+    centroid[3*root[i] + 1] += (plateau[i] / nx) % ny;
+    centroid[3*root[i] + 2] += plateau[i] / (nx*ny);
+    size[root[i]]++;
+  }
+  std::vector<std::size_t> best (plateau.size(), plateau.size());
+  std::vector<double> bestDistance (plateau.size());
+  for (std::size_t i = 0; i < plateau.size(); i++){
+    const std::size_t r = root[i];
+    const double d[3] = {static_cast<double>(plateau[i] % nx) - centroid[3*r]/size[r],
+                         static_cast<double>((plateau[i] / nx) % ny) - centroid[3*r + 1]/size[r],
+                         static_cast<double>(plateau[i] / (nx*ny)) - centroid[3*r + 2]/size[r]};
+    const double distance = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+    if (best[r] == plateau.size() || distance < bestDistance[r]){
+      best[r] = i;
+      bestDistance[r] = distance;
+    }
+  }
+  std::vector<std::size_t> res;
+  for (std::size_t i = 0; i < plateau.size(); i++){
+    if (root[i] == i && !isRootOpen[i]) res.push_back(plateau[best[i]]);
+  }
+  return res;
+}
 
 
 
-template<typename TImage>
+/**
+ * Exports the (strict) local maxima of a volume with values of type TValue.
+ *
+ * @param inputFilename the input volume.
+ * @param rawExtent the size of a raw input volume.
+ * @param ballSize the radius of the ball.
+ * @param withPlateaus if true, also exports one voxel per plateau.
+ * @param outputFilename the output point set.
+ * @param format the format of the output point set.
+ * @return true if the output file was written.
+ */
+template<typename TValue>
 bool
-isStrictLocalMax(const TImage &anImage, const Z3i::Point &aPoint, const double aRadius){
-  typedef DGtal::ImplicitBall<DGtal::Z3i::Space> EuclideanBall;
-  typedef DGtal::GaussDigitizer<DGtal::Z3i::Space, EuclideanBall> DigitalShape;
-  EuclideanBall aBall (DGtal::Z3i::Point(aPoint[0], aPoint[1], aPoint[2]), aRadius);
-  DigitalShape  gaussDig;
-  gaussDig.attach (aBall);
-  gaussDig.init(DGtal::Z3i::Point(aPoint[0]-(int)aRadius-1, aPoint[1]-(int)aRadius-1, aPoint[2]-(int)aRadius-1),
-                DGtal::Z3i::Point(aPoint[0]+(int)aRadius+1, aPoint[1]+(int)aRadius+1, aPoint[2]+(int)aRadius+1), 1);
-  DGtal::Z3i::Domain dom = gaussDig.getDomain();
-  for( DGtal::Z3i::Domain::ConstIterator it = dom.begin(); it!=dom.end(); it++){
-      if(gaussDig(*it) && anImage.domain().isInside(*it) ){
-        if (anImage(aPoint) <= anImage(*it) && aPoint != *it) {
-          return false;
-        }
+extractLocalMax(const std::string &inputFilename, const Z3i::Vector &rawExtent,
+                double ballSize, bool withPlateaus,
+                const std::string &outputFilename, PointSetFormat format)
+{
+  // rows of the point set: integers, or reals for a float volume.
+  typedef typename std::conditional<std::numeric_limits<TValue>::is_integer,
+                                    DGtal::int64_t, double>::type Scalar;
+  typedef ImageContainerBySTLVector<Z3i::Domain, TValue> Image;
+  Image image = importVolume<Image>(inputFilename, rawExtent);
+  // a voxel is a strict local maximum if it is greater than the maximum
+  // of the other voxels of the ball |p - q| <= ballSize inside the domain
+  // (max-filter computed once), and a voxel of a plateau if it is equal.
+  const StructuringElement3D ball = StructuringElement3D::ball(ballSize, true).withoutCenter();
+  const Image neighborMax = ball.reduce(image, std::numeric_limits<TValue>::lowest(),
+                                        [](TValue a, TValue b){ return std::max(a, b); });
+  const Point extent = image.domain().upperBound() - image.domain().lowerBound();
+  const int nz = extent[2] + 1;
+  const std::size_t sliceSize = static_cast<std::size_t>(extent[0] + 1)*(extent[1] + 1);
+  std::vector<std::vector<std::size_t>> sliceMaxima (nz);
+  std::vector<std::vector<std::size_t>> slicePlateaus (nz);
+#pragma omp parallel for schedule(static)
+  for (int z = 0; z < nz; z++){
+    for (std::size_t i = sliceSize*z; i < sliceSize*(z + 1); i++){
+      const TValue v = image.data()[i];
+      if (v > neighborMax.data()[i] || ball.size() == 0){
+        sliceMaxima[z].push_back(i);
+      }else if (withPlateaus && v == neighborMax.data()[i]){
+        slicePlateaus[z].push_back(i);
       }
+    }
+  }
+  std::vector<std::size_t> maxima;
+  std::vector<std::size_t> plateau;
+  for (int z = 0; z < nz; z++){
+    maxima.insert(maxima.end(), sliceMaxima[z].begin(), sliceMaxima[z].end());
+    plateau.insert(plateau.end(), slicePlateaus[z].begin(), slicePlateaus[z].end());
+  }
+  if (withPlateaus){
+    const std::vector<std::size_t> representatives = plateauRepresentatives(image, plateau);
+    trace.info() << representatives.size() << " plateaus of maxima" << std::endl;
+    maxima.insert(maxima.end(), representatives.begin(), representatives.end());
+    std::sort(maxima.begin(), maxima.end());
   }
-  return  true;
+  std::vector<Scalar> rows;
+  rows.reserve(4*maxima.size());
+  for (const auto i: maxima){
+    const Point pt = image.domain().lowerBound() +
+                     Point(i % (extent[0] + 1), (i / (extent[0] + 1)) % (extent[1] + 1), i / sliceSize);
+    rows.insert(rows.end(), {static_cast<Scalar>(pt[0]), static_cast<Scalar>(pt[1]),
+                             static_cast<Scalar>(pt[2]), static_cast<Scalar>(image.data()[i])});
+  }
+  std::stringstream comment;
+  comment << "coords of local maximas (from tools volLocalMax) obtained with a ball of radius " << ballSize;
+  return exportPointSet(outputFilename, format, rows, 4, comment.str(), &image.domain());
 }
 
+
+
 int main( int argc, char** argv )
 {
   // parse command line CLI-------------------------------------------------------
@@ -91,30 +300,57 @@ int main( int argc, char** argv )
   std::string inputFilename;
   std::string outputFilename;
   double ballSize {3.0};
+  std::vector<unsigned int> rawSize {0, 0, 0};
+  std::string rawType {"uint8"};
+  bool withPlateaus {false};
+  unsigned int nbThreads {0};
+  std::string outputFormat {"text"};
   
   app.add_option("--input,-i,1", inputFilename, "vol file (.vol) , pgm3d (.p3d or .pgm3d, pgm (with 3 dims)) file")->required()->check(CLI::ExistingFile);
   app.add_option("--output,-o,2", outputFilename, "Output SDP filename")->required();
   app.add_option("--ballSize,-b", ballSize, "set the ball size");
+  app.add_option("--outputFormat", outputFormat, "format of the output: text (sdp), bin (rows x y z value of 32 bit integers,"
+                 " 64 bit when a value does not fit in 32 bits, or floats for a float volume), npy (same array with a NumPy header) or sparse (voxels sorted and"
+                 " delta encoded, see PointSetWriter.h).")
+  ->check(CLI::IsMember(pointSetFormatNames()));
+  app.add_option("--rawSize", rawSize, "size X Y Z of a raw input volume.")
+  ->expected(3);
+  app.add_option("--rawType", rawType, "type of the values of a raw input volume.")
+  ->check(CLI::IsMember({"uint8", "uint16", "uint32", "float"}));
+  app.add_flag("--plateaus", withPlateaus, "also extract the plateaus of maxima (voxels equal to the maximum of their ball): one voxel (the nearest to the centroid) per 26-connected set of such voxels with the same value.");
+  app.add_option("--threads", nbThreads, "number of threads used to process the slabs of the volume (0: default number of threads).");
 
   app.get_formatter()->column_width(40);
   CLI11_PARSE(app, argc, argv);
   // END parse command line using CLI ----------------------------------------------
 
-  std::ofstream outStream;
-  outStream.open(outputFilename.c_str());
-  Image3D image = GenericReader<Image3D>::import (inputFilename );
-  outStream << "# coords of local maximas (from tools volLocalMax) obtained with a ball of radius " << ballSize << std::endl;
-  trace.progressBar(0, image.domain().size());
-  unsigned int pos = 0;
-  for( auto & pt : image.domain()){
-    pos++;
-    trace.progressBar(pos, image.domain().size());
-    if (isStrictLocalMax(image,pt, ballSize)) {
-      outStream << pt[0] << " " << pt[1] << " " << pt[2] << " " << (int)image(pt) << std::endl;
-    }
+#ifdef _OPENMP
+  if (nbThreads > 0){
+    omp_set_num_threads(nbThreads);
+  }
+#endif
+
+  const PointSetFormat format = pointSetFormat(outputFormat);
+  const Z3i::Vector rawExtent (rawSize[0], rawSize[1], rawSize[2]);
+  bool isWritten = false;
+  switch (volumeValueType(inputFilename, rawType)) {
+  case VolumeValueType::UINT8:
+    isWritten = extractLocalMax<DGtal::uint8_t>(inputFilename, rawExtent, ballSize, withPlateaus, outputFilename, format);
+    break;
+  case VolumeValueType::UINT16:
+    isWritten = extractLocalMax<DGtal::uint16_t>(inputFilename, rawExtent, ballSize, withPlateaus, outputFilename, format);
+    break;
+  case VolumeValueType::UINT32:
+    isWritten = extractLocalMax<DGtal::uint32_t>(inputFilename, rawExtent, ballSize, withPlateaus, outputFilename, format);
+    break;
+  case VolumeValueType::FLOAT:
+    isWritten = extractLocalMax<float>(inputFilename, rawExtent, ballSize, withPlateaus, outputFilename, format);
+    break;
+  }
+  if (!isWritten){
+    trace.error() << "can't write the output file " << outputFilename << std::endl;
+    return 1;
   }
-  outStream.close();
- 
   return 0;
 }
 
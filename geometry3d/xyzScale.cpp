@@ -7,6 +7,8 @@
 
 #include "CLI11.hpp"
 
+#include "PointSetWriter.h"
+
 using namespace DGtal;
 
 /** 
@@ -23,6 +25,8 @@ Options:
   -i,--input TEXT:FILE REQUIRED         input file name of the xyz point set.
   -o,--outputFile TEXT=output.xyz       output file name of the resulting xyz point set.
   --scale FLOAT=1                       change the scale factor
+  --outputFormat TEXT:{text,bin,npy,sparse}=text
+                                        format of the output: text (xyz), bin (rows x y z of 32 bit floats), npy (same array with a NumPy header); sparse is only defined for voxels (text is used).
 */
   
 int
@@ -35,23 +39,30 @@ main(int argc,char **argv)
   std::string inputName;
   std::string outputName {"output.xyz"};
   double scale {1.0};
+  std::string outputFormat {"text"};
   
   app.add_option("--input,-i,1", inputName, "input file name of the xyz point set.")->required()->check(CLI::ExistingFile);
   app.add_option("--output,-o", outputName, "output file name of the resulting xyz point set.");
   app.add_option("--scale", scale, "change the scale factor");
+  app.add_option("--outputFormat", outputFormat, "format of the output: text (xyz), bin (rows x y z of 32 bit floats),"
+                 " npy (same array with a NumPy header); sparse is only defined for voxels (text is used).")
+  ->check(CLI::IsMember(pointSetFormatNames()));
 
   app.get_formatter()->column_width(40);
   CLI11_PARSE(app, argc, argv);
   // END parse command line using CLI ----------------------------------------------
 
   std::vector<Z3i::RealPoint> vPt = PointListReader<Z3i::RealPoint>::getPointsFromFile(inputName);
-  std::ofstream res;
-  res.open(outputName);
+  std::vector<double> rows;
+  rows.reserve(3*vPt.size());
   for(auto &p: vPt)
     {
-      res << p[0]*scale << " "<< p[1] *scale << " "<< p[2] *scale << std::endl;
+      rows.insert(rows.end(), {p[0]*scale, p[1]*scale, p[2]*scale});
     }
-  res.close();
+  if (!exportPointSet(outputName, pointSetFormat(outputFormat), rows, 3, "")){
+    trace.error() << "can't write the output file " << outputName << std::endl;
+    return 1;
+  }
 
   return 0;
 }